@@ -2,24 +2,59 @@
 // Date: 2025-05-24 
 // Course: C Programming
 // Purpose: This program implements a simple Battleship game in C.
+// Build:   gcc -O2 -pthread valencia_battleship.c -o valencia_battleship -lm
 
 //-----------------------------------------------------------------------------
 // I. INCLUDES AND DEFINITIONS
 //-----------------------------------------------------------------------------
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L // For pthreads and sysconf
+#endif
+#ifdef __linux__
+#define _DEFAULT_SOURCE // For madvise and MADV_HUGEPAGE, which POSIX alone hides
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>   // For srand, rand, time, localtime, strftime
 #include <ctype.h>  // For toupper, isalpha, isdigit, islower, isupper
 #include <stdbool.h> // For bool type
+#include <stdint.h>  // For fixed-width fields in binary tool output
+#include <errno.h>   // For EINTR
+#include <math.h>    // For sqrt in tuning statistics
+#ifndef _WIN32
+#include <pthread.h>  // For self-play worker threads
+#include <unistd.h>   // For sysconf, getpid
+#include <fcntl.h>    // For shm_open and open flags
+#include <sys/mman.h> // For the spectator ring and solver cache mappings
+#include <sys/stat.h> // For fstat on the solver cache and spectator ring
+#include <poll.h>     // For the idle timeout on player input
+#include <signal.h>   // For ignoring SIGPIPE on tournament connections
+#include <sys/socket.h> // For the tournament coordinator and workers
+#include <netdb.h>      // For getaddrinfo
+#endif
 
 #define GRID_SIZE 10
 #define MAX_SHIPS 5
 #define MAX_SHIP_NAME_LEN 50
 #define MAX_PLAYER_NAME_LEN 4 // 3 chars + null terminator
 #define DATETIME_STR_LEN 20   // For "YYYY-MM-DD HH:MM"
+#define MAX_SHOT_HISTORY (GRID_SIZE * GRID_SIZE * 2) // Missiles remembered for post-game analysis
+#define MAX_MISSED_OPPORTUNITIES 5
+#define MISSED_OPPORTUNITY_QUALITY 0.5 // Shots below this share of the best density are reported
 #define SAVE_FILE_NAME "battleship_save_game.dat"
+#define SAVE_MAGIC "VBSV"
+#define SAVE_VERSION 3
+#define SAVE_HEADER_LEN 12 // Magic + u32 version + u32 record size, then two record slots
+#define SAVE_SLOT_HEADER_LEN 8 // u32 sequence + u32 checksum, then the GameState record
+#define SAVE_SLOT_LEN (SAVE_SLOT_HEADER_LEN + sizeof(GameState))
+#define SAVE_MERGE_GAP 16  // Unchanged bytes bridged rather than starting another incremental write
 #define SCORE_FILE_NAME "topTenScores.txt"
+#define GRID_FRAME_BUFFER_LEN 2048 // Rendered target grid (about 1 KB of text)
+#define PLAY_INPUT_LEN 10                            // Shot or Y/N answer kept from a line, plus null
+#define PLAY_INITIALS_LEN (MAX_PLAYER_NAME_LEN + 10) // Initials answer kept from a line, plus null
+#define PLAY_LINE_LEN 128
+#define IDLE_TIMEOUT_MAX_SECONDS 86400 // Keeps the poll timeout in milliseconds within an int
 
 // Cell States for Grids
 #define EMPTY_CELL '~'
@@ -27,6 +62,91 @@
 #define HIT_CELL 'H'
 // Ship letters (S, A, V, E, D) will also be used.
 
+// Compact Position Encoding (see encodePosition)
+#define POSITION_CELL_BYTES ((GRID_SIZE * GRID_SIZE * 2 + 7) / 8) // 2 bits per target grid cell
+#define POSITION_KEY_LEN (POSITION_CELL_BYTES + MAX_SHIPS)       // Cell states + one byte per ship
+#define POSITION_SHIP_AFLOAT 0xFF                                 // Ship byte for a ship not yet sunk
+
+// Self-Play and Command-Line Tools
+#define DEFAULT_HIT_WEIGHT 20     // Density weight per open hit a placement covers
+#define DEFAULT_PARITY_WEIGHT 100 // Percent of density kept off the hunt lattice
+#define DEFAULT_TARGET_RADIUS 0   // 0 = target mode may fire anywhere
+#define MAX_WORKER_THREADS 64
+#define LEGAL_MASK_BYTES ((GRID_SIZE * GRID_SIZE + 7) / 8)
+#define EXPORT_MAGIC "VBTD"
+#define EXPORT_INDEX_MAGIC "VBTI"
+#define EXPORT_VERSION 1
+#define EXPORT_HEADER_LEN 12
+#define EXPORT_CHUNK_RECORDS 4096 // Records buffered per worker before one write
+#define EXPORT_INDEX_ENTRY_LEN 12 // u64 chunk offset + u32 record count
+#define EXPORT_FOOTER_LEN 16      // u64 index offset + u32 chunk count + magic
+#define EXPORT_RECORD_LEN (POSITION_KEY_LEN + LEGAL_MASK_BYTES + GRID_SIZE * GRID_SIZE * 2 + 2)
+
+// Replay Archive (see openReplayArchiveWriter)
+#define REPLAY_MAGIC "VBRA"
+#define REPLAY_INDEX_MAGIC "VBRI"
+#define REPLAY_VERSION 1
+#define REPLAY_HEADER_LEN 12
+#define REPLAY_FOOTER_LEN 20              // u64 index offset + u64 game count + magic
+#define REPLAY_GAMES_PER_BLOCK 1024
+#define REPLAY_MAX_RECORD_LEN (MAX_SHIPS + 5 + MAX_SHOT_HISTORY * 5) // Layout + varint count + varint deltas
+#define REPLAY_SNAPSHOT_INTERVAL 16       // Moves between in-memory snapshots used for seeking
+
+// Portable Session Stream (see encodeSession)
+#define SESSION_MAGIC "VBSS"
+#define SESSION_VERSION 1
+#define SESSION_HEADER_LEN 8 // Magic + u32 version
+#define SESSION_MAX_RECORD_LEN (5 + REPLAY_MAX_RECORD_LEN + POSITION_KEY_LEN + 5 + 1)
+
+// Spectator Broadcast (see publishSpectatorEvent)
+#define SPECTATOR_SHM_NAME "/valencia_battleship_spectators"
+#define SPECTATOR_RING_MAGIC 0x56425350u  // "VBSP"
+#define SPECTATOR_RING_SLOTS 1024         // Power of two
+#define SPECTATOR_POLL_MS 50
+#define SPECTATOR_STALL_MS 100 // Give up on a slot whose writer has not finished it by then
+
+// Solver Cache (see openSolverCache)
+#define SOLVER_CACHE_MAGIC 0x56425343u  // "VBSC"
+#define SOLVER_CACHE_VERSION 2
+#define SOLVER_CACHE_ENTRIES (1u << 20) // Power of two, fixed when the file is created (40 MB, sparse)
+#define SOLVER_CACHE_MAX_PROBES 16
+#define SOLVER_CACHE_WRITING 1          // Low two tag bits while an inserter fills a slot in; its pid sits above them
+
+// Learned Shooter Model (see loadLearnedModel)
+#define MODEL_MAGIC "VBNN"
+#define MODEL_VERSION 1
+#define MODEL_INPUT_PLANES 4 // Unknown, miss, open hit, sunk
+#define MODEL_INPUT_LEN (MODEL_INPUT_PLANES * GRID_SIZE * GRID_SIZE)
+#define MODEL_MAX_LAYERS 4
+#define MODEL_MAX_WIDTH 512
+#define MODEL_LANES 8 // Rows are padded to this many floats for the vector kernel
+
+// Load Generator (see runLoadBenchmark)
+#define BENCH_DEFAULT_SESSIONS 64
+#define BENCH_MAX_SESSIONS 4096
+#define LATENCY_SUB_BUCKETS 16 // Histogram buckets per power of two (about 6% resolution)
+#define LATENCY_BUCKETS (LATENCY_SUB_BUCKETS * 61)
+
+// Parameter Tuner
+#define TUNE_BATCH_GAMES 200 // Games each surviving candidate plays per round
+#define TUNE_DROP_SIGMAS 3.0 // Drop a candidate this many standard errors behind the best
+
+// Tournaments (see runTournament, runTournamentCoordinator)
+#define TOURNAMENT_MAGIC "VBTW"
+#define TOURNAMENT_VERSION 1
+#define TOURNAMENT_BINS (GRID_SIZE * GRID_SIZE + 1) // Games by missiles fired, 0-100
+#define TOURNAMENT_SHOOTER_NAME_LEN 16
+#define TOURNAMENT_HELLO_LEN (8 + TOURNAMENT_SHOOTER_NAME_LEN) // Magic, u32 version, shooter name
+#define TOURNAMENT_LEASE_LEN 24 // u64 seed, u64 first game, u64 game count (0 = no more work)
+#define TOURNAMENT_RESULT_LEN (16 + 8 * TOURNAMENT_BINS) // u64 first game, u64 game count, histogram
+#define TOURNAMENT_DEFAULT_LEASE 1000
+#define TOURNAMENT_DEFAULT_TIMEOUT 300 // Seconds before an unreturned lease is handed to another worker
+#define TOURNAMENT_MAX_WORKERS 64      // Connections the coordinator serves at once
+#define TOURNAMENT_POLL_MS 1000
+#define TOURNAMENT_CHECKPOINT_MAGIC "VBTC"
+#define TOURNAMENT_CHECKPOINT_VERSION 1
+#define TOURNAMENT_CHECKPOINT_HEADER_LEN (40 + TOURNAMENT_SHOOTER_NAME_LEN + 8 * TOURNAMENT_BINS) // Then one bit per lease
+
 // Shot Processing Results
 typedef enum {
     SHOT_MISS,
@@ -36,6 +156,50 @@ typedef enum {
     SHOT_ERROR
 } ShotProcessResult;
 
+// Per-cell states in an encoded position
+typedef enum {
+    POSITION_UNKNOWN = 0,
+    POSITION_MISS = 1,
+    POSITION_HIT = 2  // Open hit or part of a sunk ship
+} PositionCellState;
+
+// Events published to spectators
+typedef enum {
+    SPECTATE_GAME_STARTED,
+    SPECTATE_SHOT,
+    SPECTATE_GAME_WON,
+    SPECTATE_GAME_LEFT
+} SpectatorEventType;
+
+// What an interactive game is waiting for (see advancePlaySession)
+typedef enum {
+    PLAY_AWAIT_SHOT,         // A coordinate or 'quit'
+    PLAY_AWAIT_SAVE_ON_QUIT, // Y/N: save before returning to the menu
+    PLAY_AWAIT_INITIALS,     // Initials for a top 10 score
+    PLAY_AWAIT_REVEAL,       // Y/N: show the computer's ship placements
+    PLAY_AWAIT_ENTER,        // Enter to dismiss a message, then resume_step
+    PLAY_GAME_OVER,          // Entered once the last ship sinks; never waits
+    PLAY_RETURN_TO_MENU,     // Entered to show the final prompt; never waits
+    PLAY_FINISHED,
+    PLAY_EXIT                // The player went idle or input ended; the caller saves and exits
+} PlayStep;
+
+// Operations timed by the load generator, in report order
+typedef enum {
+    BENCH_NEW_GAME,
+    BENCH_FIRE,
+    BENCH_SAVE,
+    BENCH_SCORES,
+    BENCH_OPERATION_COUNT
+} BenchOperation;
+
+// Where a coordinator's range of games stands
+typedef enum {
+    LEASE_PENDING, // Waiting for a worker
+    LEASE_ACTIVE,  // Handed out; returns to pending at its deadline
+    LEASE_DONE
+} LeaseState;
+
 // Coordinate Parsing Results
 typedef enum {
     PARSE_OK,
@@ -87,8 +251,341 @@ typedef struct {
     bool game_in_progress;
     Coordinate last_shot_coord;
     bool last_shot_valid; // To know if last_shot_coord is meaningful for highlighting
+    int shot_history_count;
+    unsigned char shot_history[MAX_SHOT_HISTORY]; // Cell index (row * GRID_SIZE + col) of each missile
 } GameState;
 
+// Canonical, fixed-size key for a target grid position. Equal positions
+// always encode to identical bytes, so keys can be compared with memcmp.
+typedef struct {
+    unsigned char bytes[POSITION_KEY_LEN];
+} PositionKey;
+
+// Small deterministic generator (splitmix64) so self-play games can be
+// reproduced from a seed and game index, independent of rand().
+typedef struct {
+    uint64_t state;
+} Rng;
+
+// Tunable knobs of the density shooter (see chooseDensityShot)
+typedef struct {
+    int hit_weight;
+    int parity_weight;
+    int target_radius;
+} ShooterParams;
+
+// A shooter picks the next cell to fire at using only the public target grid.
+typedef struct {
+    const char *name;
+    Coordinate (*choose_shot)(void *context, const char grid[GRID_SIZE][GRID_SIZE]);
+    void *context;
+} Shooter;
+
+// Appends games to a replay archive, one buffered block at a time
+typedef struct {
+    FILE *file;
+    unsigned char *block;
+    size_t block_len;
+    uint64_t next_offset;
+    uint64_t *block_offsets;
+    uint64_t block_capacity;
+    uint64_t block_count;
+    uint32_t *game_offsets;
+    uint64_t game_capacity;
+    uint64_t game_count;
+    bool write_failed;
+} ReplayArchiveWriter;
+
+// An open replay archive with its index loaded
+typedef struct {
+    FILE *file;
+    uint32_t games_per_block;
+    uint64_t game_count;
+    uint64_t block_count;
+    uint64_t *block_offsets; // block_count + 1 entries; the last is where the index starts
+    uint32_t *game_offsets;  // Offset of each game within its block
+} ReplayArchive;
+
+// One ring slot. `sequence` is 2n+1 while event n is being written and 2n+2
+// once it is complete, so readers can detect torn or overwritten slots.
+typedef struct {
+    uint64_t sequence;
+    uint32_t session_id;
+    uint8_t type;
+    uint8_t cell;
+    uint8_t result;
+    int8_t sunk_ship_index;
+    uint16_t missiles_fired;
+    PositionKey position; // Full position, so late or lagging spectators resync from any event
+} SpectatorSlot;
+
+// Shared-memory ring written by any number of game processes. Writers never
+// wait for readers; each reader keeps its own cursor and skips ahead when
+// it falls more than a ring's worth behind.
+typedef struct {
+    uint32_t magic;
+    uint32_t slot_count;
+    uint64_t write_count;
+    SpectatorSlot slots[SPECTATOR_RING_SLOTS];
+} SpectatorRing;
+
+// Per-session settings for the interactive game
+typedef struct {
+    SpectatorRing *broadcast; // NULL unless started with --broadcast
+    int idle_timeout_seconds; // 0 = wait for the player forever
+    bool autosave;            // Save after every shot (--autosave)
+} SessionOptions;
+
+// What saveGameStateIncremental last wrote to each record slot, so each
+// later save only rewrites the bytes of the slot that changed since.
+typedef struct {
+    const char *path;
+    int fd;            // Save file kept open between shots; -1 before the first full save
+    uint32_t sequence; // Sequence number of the newest slot
+    GameState saved[2];
+} SaveShadow;
+
+// One interactive game as a resumable state machine. It never reads input
+// itself: the host feeds it one line at a time, so a host can interleave
+// any number of sessions on one thread.
+typedef struct {
+    GameState *game;
+    const SessionOptions *options;
+    PlayStep step;
+    PlayStep resume_step; // Step entered once PLAY_AWAIT_ENTER gets its line
+    SaveShadow shadow;
+    bool autosaved; // This session has written the save file through --autosave
+} PlaySession;
+
+// A loaded replay with snapshots every REPLAY_SNAPSHOT_INTERVAL moves, so
+// seeking replays at most REPLAY_SNAPSHOT_INTERVAL - 1 shots.
+typedef struct {
+    GameState final_game;
+    int move_count;
+    int snapshot_count;
+    GameState snapshots[MAX_SHOT_HISTORY / REPLAY_SNAPSHOT_INTERVAL + 1];
+} ReplaySeeker;
+
+// One implementation of the dense layer kernel (see selectVectorKernels)
+typedef void (*DenseLayerKernel)(const float *weights, const float *biases, const float *input, float *output, int input_len, int output_len, bool apply_relu);
+
+// Small fully-connected policy network: ReLU between layers, one logit per
+// cell out of the last layer. All weights live in a single allocation.
+typedef struct {
+    int layer_count;
+    int input_len[MODEL_MAX_LAYERS];  // Padded to a multiple of MODEL_LANES
+    int output_len[MODEL_MAX_LAYERS];
+    const float *weights[MODEL_MAX_LAYERS];
+    const float *biases[MODEL_MAX_LAYERS];
+    float *storage;
+} LearnedModel;
+
+// One solved position in the shared solver cache. `tag` is 0 while the slot
+// is free, the inserter's pid << 2 | SOLVER_CACHE_WRITING while it fills the
+// slot in, and the key's hash once it is complete; key and shot never change
+// after that. A slot whose inserter died mid-write is reclaimed by the next
+// insert that finds it.
+typedef struct {
+    uint64_t tag;
+    unsigned char key[POSITION_KEY_LEN];
+    uint8_t best_cell;
+    uint8_t reserved;
+} SolverCacheEntry;
+
+// Start of a solver cache file, followed by `capacity` entries. Native byte
+// order: the file is shared by processes on one machine, not between hosts.
+typedef struct {
+    uint32_t magic; // Stored last by the creator, so openers can wait for it
+    uint32_t version;
+    uint32_t capacity;
+    int32_t hit_weight; // Density shooter parameters the answers belong to
+    int32_t parity_weight;
+    int32_t target_radius;
+    uint64_t reserved[5];
+} SolverCacheHeader;
+
+// An open solver cache and this process's counters
+typedef struct {
+    SolverCacheHeader *header;
+    SolverCacheEntry *entries;
+    size_t map_len;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t inserts;
+    uint64_t dropped; // Inserts abandoned because every probed slot was taken
+    bool huge_pages;  // The kernel accepted MADV_HUGEPAGE for the mapping
+    uint64_t writing_tag; // This process's tag for slots it is filling in
+} SolverCache;
+
+// A shooter chosen by the tool options, with everything it owns
+typedef struct {
+    Shooter shooter;  // What the tools call
+    Shooter uncached; // The shooter behind the cache when --cache is given
+    LearnedModel model;
+    SolverCache *cache;
+} ToolShooter;
+
+// One parameter set under evaluation by the tuner
+typedef struct {
+    ShooterParams params;
+    bool alive;
+    long games_played;
+    short *missiles; // Per game of the run, in game order
+} TuneCandidate;
+
+#ifdef _WIN32
+typedef int ToolMutex; // Worker threads run one after another on Windows
+#else
+typedef pthread_mutex_t ToolMutex;
+#endif
+
+typedef struct {
+    const char *mode;
+    const char *path;
+    long game_count;
+    long first_game;
+    uint64_t seed;
+    int thread_count;
+    const char *shooter_name;
+    const char *weights_path;
+    const char *cache_path;
+    const char *cpu_level; // NULL = best the CPU supports
+    int session_count; // Live sessions for --bench
+    int think_ms;      // Mean think time between a session's commands for --bench
+    long lease_games;    // Games per lease for --coordinate
+    int lease_timeout_s; // Seconds a --coordinate lease may stay out
+    const char *checkpoint_path; // Tournament progress file, NULL for none
+} ToolOptions;
+
+// Log-linear latency histogram: exact below LATENCY_SUB_BUCKETS ns, then
+// LATENCY_SUB_BUCKETS buckets per power of two.
+typedef struct {
+    uint64_t counts[LATENCY_BUCKETS];
+    uint64_t total;
+    uint64_t max_ns;
+} LatencyHistogram;
+
+// One simulated player of the load generator
+typedef struct {
+    GameState game;
+    SaveShadow shadow;
+    char save_path[32];
+    uint64_t due_ns; // When this player sends its next command
+    bool playing;
+} BenchSession;
+
+// Tournament results: how many games needed each number of missiles.
+// Histograms from disjoint game ranges merge by adding them.
+typedef struct {
+    uint64_t games[TOURNAMENT_BINS];
+} MissileHistogram;
+
+// One tournament thread; plays every worker_count-th game of a range
+typedef struct {
+    const Shooter *shooter;
+    uint64_t seed;
+    long first_game;
+    long game_count;
+    int worker_index;
+    int worker_count;
+    MissileHistogram histogram;
+} TournamentWorker;
+
+// One range of games handed out by the coordinator
+typedef struct {
+    long first_game;
+    long game_count;
+    LeaseState state;
+    int holder;           // Connection working on it while active
+    uint64_t deadline_ns; // monotonicNanos() after which it is handed out again
+} TournamentLease;
+
+// One worker connection at the coordinator
+typedef struct {
+    int fd;               // -1 for a free slot
+    bool greeted;         // Hello received and accepted
+    bool awaiting_result; // A lease was sent and its result is still due
+    long lease;           // Index of the lease last sent, -1 if none
+    size_t received;      // Bytes of the current message read so far
+    unsigned char buffer[TOURNAMENT_RESULT_LEN];
+} CoordinatorConnection;
+
+// Everything tracked while a tournament runs, locally or by the coordinator
+typedef struct {
+    const ToolOptions *options;
+    TournamentLease *leases;
+    long lease_count;
+    long leases_done;
+    CoordinatorConnection connections[TOURNAMENT_MAX_WORKERS];
+    MissileHistogram histogram;
+} TournamentCoordinator;
+
+// Shared output of the training-data exporter
+typedef struct {
+    FILE *file;
+    ToolMutex lock;
+    uint64_t next_offset;
+    unsigned char *index;
+    uint32_t chunk_count;
+    uint32_t chunk_capacity;
+    uint64_t record_count;
+    bool write_failed;
+} ExportSink;
+
+// One tuner worker; plays its share of a round for every surviving candidate
+typedef struct {
+    TuneCandidate *candidates;
+    int candidate_count;
+    const ToolOptions *options;
+    long round_start;
+    long round_games;
+    int worker_index;
+    int worker_count;
+} TuneWorker;
+
+// One batch-analysis worker; reads whole blocks through its own FILE handle
+typedef struct {
+    const ReplayArchive *archive;
+    const char *path;
+    int worker_index;
+    int worker_count;
+    uint64_t games;
+    uint64_t shots;
+    uint64_t missiles;
+    uint64_t missed_opportunities;
+    double quality_total;
+    uint64_t efficiency_histogram[11]; // Per-game efficiency in 10% buckets
+    bool read_failed;
+} AnalyzeWorker;
+
+// One exporter worker; plays games first_game + worker_index, + worker_count, ...
+typedef struct {
+    ExportSink *sink;
+    const Shooter *shooter;
+    const ToolOptions *options;
+    int worker_index;
+    int worker_count;
+    unsigned char *buffer;
+    uint32_t buffered_records;
+} ExportWorker;
+
+// A turn where a clearly better shot was available
+typedef struct {
+    int turn;
+    Coordinate played;
+    Coordinate best;
+    double quality;
+} MissedOpportunity;
+
+// Post-game shot quality: each shot's density as a share of the best
+// available shot's density, averaged into an efficiency score.
+typedef struct {
+    int shots_analyzed;
+    double efficiency;
+    int missed_count;
+    MissedOpportunity missed[MAX_MISSED_OPPORTUNITIES]; // Worst first
+} RegretReport;
+
 typedef struct {
     char player_name[MAX_PLAYER_NAME_LEN];
     int score_value;
@@ -105,52 +602,199 @@ int getMenuChoice();
 void displayHelpScreen();
 
 // Game Setup Functions
-void initializeNewGame(GameState *game);
-void setupComputerShips(GameState *game);
+void initializeNewGame(GameState *game, Rng *rng);
+void resetGameState(GameState *game, Rng *rng);
+void setupComputerShips(GameState *game, Rng *rng);
 bool isValidShipPlacement(const char grid[GRID_SIZE][GRID_SIZE], const ShipTypeInfo* ship_type, int r, int c, int orientation);
 
-// Gameplay Loop Function
-void playGame(GameState *game);
+// Gameplay Loop Functions
+PlayStep playGame(GameState *game, const SessionOptions *session);
+void startPlaySession(PlaySession *play, GameState *game, const SessionOptions *session);
+bool advancePlaySession(PlaySession *play, const char *line);
+void enterPlayStep(PlaySession *play, PlayStep step);
+void awaitEnter(PlaySession *play, const char *message, PlayStep next_step);
+void handleShotInput(PlaySession *play, const char *line);
+bool parseSessionOptions(int argc, char *argv[], SessionOptions *session);
 
 // Gameplay Helper Functions
 void displayPlayerTargetGrid(const char grid[GRID_SIZE][GRID_SIZE], Coordinate last_shot, bool highlight_last_shot);
+size_t renderTargetGridFrame(char* buffer, size_t buffer_size, const char grid[GRID_SIZE][GRID_SIZE], Coordinate last_shot, bool highlight_last_shot);
 void displayShipStatusAndStats(const GameState *game);
 void displayComputerOceanGrid_Revealed(const char grid[GRID_SIZE][GRID_SIZE]);
-void getPlayerShotInput(char* buffer, int buffer_size, const char* prompt);
+void normalizeShotInput(char* buffer);
+bool waitForPlayerInput(int timeout_seconds);
 ShotParseError parseShotCoordinates(const char* shot_str, int* r, int* c);
 ShotProcessResult processPlayerShot(GameState *game, int r_shot, int c_shot);
+ShotProcessResult fireShot(GameState *game, int r_shot, int c_shot, int *sunk_ship_index);
 void updateTargetGridForSunkShip(GameState *game, const Ship* sunk_ship);
 char numberToLetter(int num);
 int letterToNumber(char val);
 
 // Game State Persistence Functions
 bool saveGameState(const GameState *game);
+bool saveGameStateToFile(const GameState *game, const char *path);
 bool loadGameState(GameState *game);
+bool isValidGameState(const GameState *game);
+bool writeFileAtomically(const char *path, const void *data, size_t len);
+bool saveGameStateIncremental(const GameState *game, SaveShadow *shadow);
+uint32_t saveSlotChecksum(uint32_t sequence, const GameState *game);
+void putSaveSlot(unsigned char *slot, uint32_t sequence, const GameState *game);
+void endIncrementalSaves(SaveShadow *shadow);
+size_t encodeSession(const GameState *game, unsigned char *out);
+bool decodeSession(const unsigned char *in, size_t len, GameState *game);
 
 // Scoring Functions
 void viewTopScores();
-void updateTopScores(int new_score_value);
+void displayTopScores();
 int readScoresFromFile(ScoreEntry scores_array[], int max_scores);
 void writeScoresToFile(const ScoreEntry scores_array[], int count);
 void sortScores(ScoreEntry scores_array[], int count);
+bool scoreQualifies(const ScoreEntry scores_array[], int count, int new_score_value);
+int insertScore(ScoreEntry scores_array[], int count, const ScoreEntry *new_entry);
 void getCurrentDateTimeString(char* buffer, int buffer_size);
 
+// Position Encoding Functions
+void encodePosition(const char grid[GRID_SIZE][GRID_SIZE], PositionKey *key);
+bool decodePosition(const PositionKey *key, char grid[GRID_SIZE][GRID_SIZE]);
+PositionCellState getPositionCell(const PositionKey *key, int r, int c);
+
+// Self-Play Functions
+void rngSeed(Rng *rng, uint64_t seed);
+uint64_t rngNext(Rng *rng);
+int rngBelow(Rng *rng, int bound);
+uint64_t selfPlayGameSeed(uint64_t base_seed, long game_index);
+void computeTargetDensity(const char grid[GRID_SIZE][GRID_SIZE], int hit_weight, unsigned int density[GRID_SIZE][GRID_SIZE]);
+Coordinate chooseDensityShot(void *context, const char grid[GRID_SIZE][GRID_SIZE]);
+int playSelfPlayGame(GameState *game, const Shooter *shooter);
+void buildLegalShotMask(const char grid[GRID_SIZE][GRID_SIZE], unsigned char mask[LEGAL_MASK_BYTES]);
+
+// Replay Archive Functions
+bool openReplayArchiveWriter(const char *path, ReplayArchiveWriter *writer);
+bool appendReplay(ReplayArchiveWriter *writer, const GameState *game);
+bool closeReplayArchiveWriter(ReplayArchiveWriter *writer);
+void flushReplayBlock(ReplayArchiveWriter *writer);
+bool openReplayArchive(const char *path, ReplayArchive *archive);
+bool readReplay(const ReplayArchive *archive, uint64_t game_index, GameState *game);
+void closeReplayArchive(ReplayArchive *archive);
+size_t encodeReplay(const GameState *game, unsigned char *out);
+bool decodeReplay(const unsigned char *in, size_t len, GameState *game);
+void buildReplaySeeker(const GameState *game, ReplaySeeker *seeker);
+void seekReplay(const ReplaySeeker *seeker, int move, GameState *at);
+size_t putVarint(unsigned char *out, uint32_t value);
+size_t getVarint(const unsigned char *in, size_t len, uint32_t *value);
+
+// Learned Shooter Functions
+bool loadLearnedModel(const char *path, LearnedModel *model);
+void freeLearnedModel(LearnedModel *model);
+Coordinate chooseLearnedShot(void *context, const char grid[GRID_SIZE][GRID_SIZE]);
+void encodeModelInput(const char grid[GRID_SIZE][GRID_SIZE], float input[MODEL_INPUT_LEN]);
+void denseLayerForward(const float *weights, const float *biases, const float *input, float *output, int input_len, int output_len, bool apply_relu);
+void denseLayerForwardPortable(const float *weights, const float *biases, const float *input, float *output, int input_len, int output_len, bool apply_relu);
+void denseLayerForwardAvx2(const float *weights, const float *biases, const float *input, float *output, int input_len, int output_len, bool apply_relu);
+bool selectVectorKernels(const char *level);
+
+// Post-Game Analysis Functions
+void rebuildStartingGame(const GameState *game, GameState *start);
+void analyzeShotHistory(const GameState *game, RegretReport *report);
+void displayRegretReport(const RegretReport *report);
+
+// Solver Cache Functions
+SolverCache *openSolverCache(const char *path, const ShooterParams *params);
+void closeSolverCache(SolverCache *cache);
+bool lookupSolverCache(SolverCache *cache, const PositionKey *key, int *best_cell);
+void insertSolverCache(SolverCache *cache, const PositionKey *key, int best_cell);
+bool solverCacheWriterAlive(uint64_t tag);
+uint64_t hashPositionKey(const PositionKey *key);
+void reportSolverCachePages(const SolverCache *cache);
+size_t hugePageBytes(const void *address);
+Coordinate chooseCachedShot(void *context, const char grid[GRID_SIZE][GRID_SIZE]);
+
+// Tournament Functions
+int runTournament(const ToolOptions *options);
+void playTournamentRange(const Shooter *shooter, uint64_t seed, long first_game, long game_count, int thread_count, MissileHistogram *histogram);
+void *tournamentWorkerMain(void *arg);
+void mergeMissileHistogram(MissileHistogram *into, const MissileHistogram *from);
+int missilePercentile(const MissileHistogram *histogram, uint64_t games, double fraction);
+void printTournamentReport(const ToolOptions *options, const MissileHistogram *histogram);
+bool startTournamentLeases(TournamentCoordinator *coordinator, const ToolOptions *options);
+void completeTournamentLease(TournamentCoordinator *coordinator, long lease_index, const MissileHistogram *result);
+bool writeTournamentCheckpoint(const TournamentCoordinator *coordinator);
+bool loadTournamentCheckpoint(TournamentCoordinator *coordinator);
+int runTournamentCoordinator(const ToolOptions *options);
+void assignTournamentLeases(TournamentCoordinator *coordinator);
+void acceptTournamentWorker(TournamentCoordinator *coordinator, int listener);
+void serviceTournamentConnection(TournamentCoordinator *coordinator, int index);
+void dropTournamentConnection(TournamentCoordinator *coordinator, int index, const char *reason);
+int runTournamentWorker(const ToolOptions *options);
+int openTournamentListener(const char *port);
+int connectToCoordinator(const char *address);
+bool sendAllBytes(int fd, const unsigned char *data, size_t len);
+bool receiveAllBytes(int fd, unsigned char *data, size_t len);
+
+// Spectator Broadcast Functions
+SpectatorRing *openSpectatorRing(bool create);
+void closeSpectatorRing(SpectatorRing *ring);
+void publishSpectatorEvent(SpectatorRing *ring, const GameState *game, SpectatorEventType type, int cell, ShotProcessResult result, int sunk_ship_index);
+int runSpectator(const ToolOptions *options);
+
+// Command-Line Tool Functions
+int runCommandLineTool(int argc, char *argv[]);
+bool parseToolOptions(int argc, char *argv[], ToolOptions *options);
+bool createToolShooter(const ToolOptions *options, ToolShooter *tool_shooter);
+void freeToolShooter(ToolShooter *tool_shooter);
+void printToolUsage(const char *program);
+int defaultWorkerCount();
+void runWorkers(void *(*worker_function)(void *), void *workers, size_t worker_size, int worker_count);
+void toolMutexInit(ToolMutex *mutex);
+void toolMutexLock(ToolMutex *mutex);
+void toolMutexUnlock(ToolMutex *mutex);
+void toolMutexDestroy(ToolMutex *mutex);
+int runTrainingDataExport(const ToolOptions *options);
+void *exportWorkerMain(void *arg);
+int runParameterTuning(const ToolOptions *options);
+int runReplayArchiveCreation(const ToolOptions *options);
+int runArchiveAnalysis(const ToolOptions *options);
+int runReplayViewer(const ToolOptions *options);
+int runSessionExport(const ToolOptions *options);
+int runSessionImport(const ToolOptions *options);
+int runLoadBenchmark(const ToolOptions *options);
+void recordLatency(LatencyHistogram *histogram, uint64_t nanoseconds);
+uint64_t latencyPercentile(const LatencyHistogram *histogram, double fraction);
+void *analyzeWorkerMain(void *arg);
+void *tuneWorkerMain(void *arg);
+void appendExportRecord(ExportWorker *worker, const GameState *game, const unsigned int density[GRID_SIZE][GRID_SIZE], Coordinate shot, ShotProcessResult result);
+void flushExportChunk(ExportWorker *worker);
+void putUint16LE(unsigned char *out, uint16_t value);
+void putUint32LE(unsigned char *out, uint32_t value);
+void putUint64LE(unsigned char *out, uint64_t value);
+uint32_t getUint32LE(const unsigned char *in);
+uint64_t getUint64LE(const unsigned char *in);
+float getFloat32LE(const unsigned char *in);
+
 // Utility Functions
 void clearScreen();
+uint64_t monotonicNanos();
 void pauseForKey(const char* message);
-void safeGets(char *buffer, int size);
+bool safeGets(char *buffer, int size);
 
 //-----------------------------------------------------------------------------
 // IV. MAIN FUNCTION
 //-----------------------------------------------------------------------------
-int main() {
+int main(int argc, char *argv[]) {
+    SessionOptions session;
+    if (!parseSessionOptions(argc, argv, &session)) {
+        return runCommandLineTool(argc, argv);
+    }
+
     GameState current_game;
+    Rng rng;
     current_game.game_in_progress = false;
     current_game.last_shot_valid = false;
     bool running = true;
     int choice;
+    PlayStep step = PLAY_FINISHED;
 
-    srand(time(NULL)); // Seed random number generator once
+    rngSeed(&rng, (uint64_t)time(NULL)); // Seed random number generator once
 
     printf("Welcome to Battleship!\n");
     pauseForKey("Press Enter to continue to the Main Menu...");
@@ -161,19 +805,19 @@ int main() {
 
         switch (choice) {
             case 1: // Start New Game
-                initializeNewGame(&current_game);
-                playGame(&current_game);
+                initializeNewGame(&current_game, &rng);
+                step = playGame(&current_game, &session);
                 break;
             case 2: // Resume Game
                 if (loadGameState(&current_game)) {
                     printf("Game resumed.\n");
                     pauseForKey("Press Enter to start playing...");
-                    playGame(&current_game);
+                    step = playGame(&current_game, &session);
                 } else {
                     printf("No saved game found or error loading.\n");
                     pauseForKey("Press Enter to start a new game instead...");
-                    initializeNewGame(&current_game);
-                    playGame(&current_game);
+                    initializeNewGame(&current_game, &rng);
+                    step = playGame(&current_game, &session);
                 }
                 break;
             case 3: // View Top 10 Scores
@@ -197,6 +841,7 @@ int main() {
                     }
                 }
                 running = false;
+                closeSpectatorRing(session.broadcast);
                 printf("Exiting game. Goodbye!\n");
                 break;
             default:
@@ -204,6 +849,16 @@ int main() {
                 pauseForKey(NULL); 
                 break;
         }
+
+        if (step == PLAY_EXIT) {
+            // The player went idle or input ended mid-session: keep the game and leave.
+            if (current_game.game_in_progress) {
+                if (saveGameState(&current_game)) printf("Game saved. Choose Resume Game next time to continue.\n");
+                else printf("Error saving game.\n");
+            }
+            closeSpectatorRing(session.broadcast);
+            running = false;
+        }
     }
     return 0;
 }
@@ -270,7 +925,13 @@ void displayHelpScreen() {
 //-----------------------------------------------------------------------------
 // VI. GAME SETUP FUNCTIONS
 //-----------------------------------------------------------------------------
-void initializeNewGame(GameState *game) {
+void initializeNewGame(GameState *game, Rng *rng) {
+    resetGameState(game, rng);
+    printf("New game initialized. The computer has secretly placed its ships.\n");
+    pauseForKey("Press Enter to begin...");
+}
+
+void resetGameState(GameState *game, Rng *rng) {
     for (int r = 0; r < GRID_SIZE; ++r) {
         for (int c = 0; c < GRID_SIZE; ++c) {
             game->player_target_grid[r][c] = EMPTY_CELL; 
@@ -290,22 +951,21 @@ void initializeNewGame(GameState *game) {
     game->ships_remaining_count = MAX_SHIPS;
     game->game_in_progress = true;
     game->last_shot_valid = false;
+    game->shot_history_count = 0;
 
-    setupComputerShips(game);
-    printf("New game initialized. The computer has secretly placed its ships.\n");
-    pauseForKey("Press Enter to begin...");
+    setupComputerShips(game, rng);
 }
 
-void setupComputerShips(GameState *game) {
+void setupComputerShips(GameState *game, Rng *rng) {
     for (int i = 0; i < MAX_SHIPS; ++i) {
         const ShipTypeInfo* current_ship_type = &SHIP_TYPES[i];
         bool placed_successfully = false;
         int attempts = 0;
 
         while (!placed_successfully && attempts < 1000) { 
-            int start_row = rand() % GRID_SIZE;
-            int start_col = rand() % GRID_SIZE;
-            int orientation = rand() % 2; 
+            int start_row = rngBelow(rng, GRID_SIZE);
+            int start_col = rngBelow(rng, GRID_SIZE);
+            int orientation = rngBelow(rng, 2);
 
             if (isValidShipPlacement(game->computer_ocean_grid, current_ship_type, start_row, start_col, orientation)) {
                 for (int j = 0; j < current_ship_type->size; ++j) {
@@ -352,151 +1012,318 @@ bool isValidShipPlacement(const char grid[GRID_SIZE][GRID_SIZE], const ShipTypeI
 //-----------------------------------------------------------------------------
 // VII. GAMEPLAY LOOP FUNCTION
 //-----------------------------------------------------------------------------
-void playGame(GameState *game) {
-    char shot_input_str[10];
-    int shot_row, shot_col;
-    ShotParseError parse_err;
+// Interactive options: --broadcast, --idle-timeout SECONDS, --autosave.
+// Returns false if the arguments are for one of the command-line tools instead,
+// or if the idle timeout is not a whole number of seconds.
+bool parseSessionOptions(int argc, char *argv[], SessionOptions *session) {
+    session->broadcast = NULL;
+    session->idle_timeout_seconds = 0;
+    session->autosave = false;
 
-    while (game->ships_remaining_count > 0 && game->game_in_progress) {
-        clearScreen();
-        displayPlayerTargetGrid(game->player_target_grid, game->last_shot_coord, game->last_shot_valid);
-        displayShipStatusAndStats(game);
-
-        printf("Enter 'quit' to return to main menu.\n");
-        getPlayerShotInput(shot_input_str, sizeof(shot_input_str), "Your command (e.g., A5 or quit): ");
-
-        if (strcmp(shot_input_str, "quit") == 0 || strcmp(shot_input_str, "QUIT") == 0) {
-            char save_prompt[10];
-            printf("Are you sure you want to quit this game session?\n");
-            printf("Save current game before returning to menu? (Y/N): ");
-            safeGets(save_prompt, sizeof(save_prompt));
-            if (toupper(save_prompt[0]) == 'Y') {
+    bool broadcast = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--broadcast") == 0) {
+            broadcast = true;
+        } else if (strcmp(argv[i], "--idle-timeout") == 0 && i + 1 < argc) {
+            char *end;
+            long seconds = strtol(argv[++i], &end, 10);
+            if (end == argv[i] || *end != '\0' || seconds < 0 || seconds > IDLE_TIMEOUT_MAX_SECONDS) {
+                fprintf(stderr, "Error: --idle-timeout takes 0 to %d seconds, not '%s'.\n", IDLE_TIMEOUT_MAX_SECONDS, argv[i]);
+                return false;
+            }
+            session->idle_timeout_seconds = (int)seconds;
+        } else if (strcmp(argv[i], "--autosave") == 0) {
+            session->autosave = true;
+        } else {
+            return false;
+        }
+    }
+
+    if (broadcast) {
+        session->broadcast = openSpectatorRing(true);
+        if (session->broadcast == NULL) {
+            fprintf(stderr, "Warning: Spectator broadcast unavailable; playing without it.\n");
+        }
+    }
+    return true;
+}
+
+// Blocking host for one interactive session: reads a line whenever the
+// session is waiting for one. Returns PLAY_EXIT if the player went idle or
+// input ended, leaving the caller to save the game and shut down.
+PlayStep playGame(GameState *game, const SessionOptions *session) {
+    PlaySession play;
+    char line[PLAY_LINE_LEN];
+
+    startPlaySession(&play, game, session);
+    while (play.step != PLAY_FINISHED) {
+        bool idle = play.step == PLAY_AWAIT_SHOT && !waitForPlayerInput(session->idle_timeout_seconds);
+        if (idle) printf("\nNo input for %d seconds.\n", session->idle_timeout_seconds);
+        if (idle || !safeGets(line, sizeof(line))) {
+            endIncrementalSaves(&play.shadow);
+            if (game->game_in_progress) publishSpectatorEvent(session->broadcast, game, SPECTATE_GAME_LEFT, 0, SHOT_MISS, -1);
+            return PLAY_EXIT;
+        }
+        advancePlaySession(&play, line);
+    }
+    return PLAY_FINISHED;
+}
+
+// Shows the first board and waits for the first shot.
+void startPlaySession(PlaySession *play, GameState *game, const SessionOptions *session) {
+    play->game = game;
+    play->options = session;
+    play->shadow.path = SAVE_FILE_NAME;
+    play->shadow.fd = -1;
+    play->autosaved = false;
+    publishSpectatorEvent(session->broadcast, game, SPECTATE_GAME_STARTED, 0, SHOT_MISS, -1);
+    enterPlayStep(play, PLAY_AWAIT_SHOT);
+}
+
+// Feeds one line of player input to the session and prints everything up
+// to its next prompt. Returns false once the session has finished.
+bool advancePlaySession(PlaySession *play, const char *line) {
+    GameState *game = play->game;
+    char answer[PLAY_INITIALS_LEN];
+
+    switch (play->step) {
+        case PLAY_AWAIT_SHOT:
+            handleShotInput(play, line);
+            break;
+        case PLAY_AWAIT_SAVE_ON_QUIT:
+            if (toupper(line[0]) == 'Y') {
                  if(saveGameState(game)) printf("Game saved.\n"); else printf("Error saving game.\n");
+            } else if (play->autosaved) {
+                remove(SAVE_FILE_NAME); // Declining also discards what autosave kept
             }
             game->game_in_progress = false; 
-            pauseForKey("Returning to Main Menu...");
-            return;
+            publishSpectatorEvent(play->options->broadcast, game, SPECTATE_GAME_LEFT, 0, SHOT_MISS, -1);
+            endIncrementalSaves(&play->shadow);
+            awaitEnter(play, "Returning to Main Menu...", PLAY_FINISHED);
+            break;
+        case PLAY_AWAIT_INITIALS: {
+            snprintf(answer, sizeof(answer), "%s", line);
+            if (strlen(answer) != 3) {
+                printf("Error: Initials must be exactly 3 characters. Please try again.\n");
+                printf("Enter your initials (3 characters, e.g., ACE): ");
+                break;
+            }
+            ScoreEntry scores[11]; 
+            int count = readScoresFromFile(scores, 10);
+            ScoreEntry new_entry;
+            strncpy(new_entry.player_name, answer, MAX_PLAYER_NAME_LEN -1);
+            new_entry.player_name[MAX_PLAYER_NAME_LEN - 1] = '\0';
+            new_entry.score_value = game->missiles_fired_count;
+            getCurrentDateTimeString(new_entry.date_time_achieved, DATETIME_STR_LEN);
+            count = insertScore(scores, count, &new_entry);
+            writeScoresToFile(scores, count); 
+            printf("Your score has been recorded!\n");
+            displayTopScores();
+            awaitEnter(play, NULL, PLAY_AWAIT_REVEAL);
+            break;
         }
+        case PLAY_AWAIT_REVEAL:
+            if (toupper(line[0]) == 'Y') {
+                displayComputerOceanGrid_Revealed(game->computer_ocean_grid);
+                awaitEnter(play, "This was the computer's setup. Press Enter to continue...", PLAY_RETURN_TO_MENU);
+            } else {
+                enterPlayStep(play, PLAY_RETURN_TO_MENU);
+            }
+            break;
+        case PLAY_AWAIT_ENTER:
+            enterPlayStep(play, play->resume_step);
+            break;
+        default:
+            break;
+    }
+    return play->step != PLAY_FINISHED;
+}
 
-        parse_err = parseShotCoordinates(shot_input_str, &shot_row, &shot_col);
-        game->last_shot_valid = false; 
+// Prints what a step shows on arrival, ending at its prompt.
+void enterPlayStep(PlaySession *play, PlayStep step) {
+    GameState *game = play->game;
+    play->step = step;
 
-        if (parse_err != PARSE_OK) {
-            switch (parse_err) {
-                case PARSE_ERROR_FORMAT: printf("Error: Invalid coordinate format. Use LetterNumber (e.g., A5, J10).\n"); break;
-                case PARSE_ERROR_COL_RANGE: printf("Error: Column out of range. Must be A-J.\n"); break;
-                case PARSE_ERROR_ROW_NAN: printf("Error: Row must be a number.\n"); break;
-                case PARSE_ERROR_ROW_RANGE: printf("Error: Row out of range. Must be 1-10.\n"); break;
-                default: printf("Error: Unknown coordinate parsing error.\n"); break;
+    switch (step) {
+        case PLAY_AWAIT_SHOT:
+            if (game->ships_remaining_count == 0) {
+                enterPlayStep(play, PLAY_GAME_OVER);
+            } else if (!game->game_in_progress) {
+                enterPlayStep(play, PLAY_RETURN_TO_MENU);
+            } else {
+                clearScreen();
+                displayPlayerTargetGrid(game->player_target_grid, game->last_shot_coord, game->last_shot_valid);
+                displayShipStatusAndStats(game);
+                printf("Enter 'quit' to return to main menu.\n");
+                printf("Your command (e.g., A5 or quit): ");
+            }
+            break;
+        case PLAY_GAME_OVER: {
+            endIncrementalSaves(&play->shadow);
+            publishSpectatorEvent(play->options->broadcast, game, SPECTATE_GAME_WON, 0, SHOT_SUNK, -1);
+            if (play->options->autosave) remove(SAVE_FILE_NAME); // A finished game is not resumable
+            clearScreen();
+            displayPlayerTargetGrid(game->player_target_grid, game->last_shot_coord, false); 
+            displayShipStatusAndStats(game); 
+            printf("\n====================================================\n");
+            printf("    CONGRATULATIONS! You sunk all enemy ships!    \n");
+            printf("====================================================\n");
+            printf("Total missiles fired: %d\n", game->missiles_fired_count);
+            if (game->missiles_fired_count == 17) { 
+                printf("A PERFECT GAME! You used the minimum possible missiles!\n");
             }
-            pauseForKey(NULL);
-            continue;
-        }
-        
-        game->last_shot_coord.row = shot_row; 
-        game->last_shot_coord.col = shot_col;
-        game->last_shot_valid = true;
 
-        if (game->player_target_grid[shot_row][shot_col] != EMPTY_CELL &&
-            game->player_target_grid[shot_row][shot_col] != HIT_CELL) { 
-            printf("You've already conclusively fired at %s (%c). Try a different spot.\n", shot_input_str, game->player_target_grid[shot_row][shot_col]);
-            pauseForKey(NULL);
-            continue;
+            RegretReport report;
+            analyzeShotHistory(game, &report);
+            displayRegretReport(&report);
+
+            ScoreEntry scores[10]; 
+            int count = readScoresFromFile(scores, 10);
+            if (scoreQualifies(scores, count, game->missiles_fired_count)) {
+                printf("\nCongratulations! You've made the Top 10 high scores!\n");
+                printf("Enter your initials (3 characters, e.g., ACE): ");
+                play->step = PLAY_AWAIT_INITIALS;
+            } else {
+                printf("Good game! Your score of %d missiles was not quite enough for the Top 10 this time.\n", game->missiles_fired_count);
+                enterPlayStep(play, PLAY_AWAIT_REVEAL);
+            }
+            break;
         }
+        case PLAY_AWAIT_REVEAL:
+            game->game_in_progress = false;
+            printf("\nWould you like to see the computer's ship placements? (Y/N): ");
+            break;
+        case PLAY_RETURN_TO_MENU:
+            awaitEnter(play, "Press Enter to return to the Main Menu...", PLAY_FINISHED);
+            break;
+        default:
+            break;
+    }
+}
 
-        game->missiles_fired_count++;
-        ShotProcessResult result = processPlayerShot(game, shot_row, shot_col);
-        char result_message[100] = "";
+// Shows a message the way pauseForKey does, then waits for Enter.
+void awaitEnter(PlaySession *play, const char *message, PlayStep next_step) {
+    if (message != NULL && strlen(message) > 0) {
+        printf("%s\n", message);
+    } else {
+        printf("Press Enter to continue...");
+    }
+    play->step = PLAY_AWAIT_ENTER;
+    play->resume_step = next_step;
+}
 
-        switch (result) {
-            case SHOT_MISS:
-                sprintf(result_message, "***** M I S S *****");
-                game->player_target_grid[shot_row][shot_col] = MISS_CELL;
-                break;
-            case SHOT_HIT:
-                sprintf(result_message, "***** H I T ! *****");
-                game->player_target_grid[shot_row][shot_col] = HIT_CELL;
-                break;
-            case SHOT_SUNK:
-                for (int i = 0; i < MAX_SHIPS; ++i) { 
-                    if (game->computer_fleet[i].is_sunk) {
-                        bool this_ship_hit = false;
-                        for(int k=0; k < game->computer_fleet[i].size; ++k) {
-                            if(game->computer_fleet[i].segments[k].row == shot_row && game->computer_fleet[i].segments[k].col == shot_col) {
-                                this_ship_hit = true; break;
-                            }
-                        }
-                        if(this_ship_hit) {
-                            sprintf(result_message, "***** YOU SUNK THE %s! (%c) *****", game->computer_fleet[i].name_long, game->computer_fleet[i].letter);
-                            updateTargetGridForSunkShip(game, &game->computer_fleet[i]);
-                            break; 
-                        }
-                    }
-                }
-                break;
-            case SHOT_ALREADY_PROCESSED:
-                sprintf(result_message, "You already hit that spot. It's part of a ship (%c).", game->player_target_grid[shot_row][shot_col]);
-                break;
-            case SHOT_ERROR:
-                sprintf(result_message, "Error processing shot. Please report this.");
-                break;
-        }
-        printf("\n%s\n", result_message);
-        pauseForKey("Press Enter for next turn or results...");
-    } 
+void handleShotInput(PlaySession *play, const char *line) {
+    GameState *game = play->game;
+    char shot_input_str[PLAY_INPUT_LEN];
+    int shot_row, shot_col;
+    ShotParseError parse_err;
 
-    if (game->ships_remaining_count == 0) {
-        clearScreen();
-        displayPlayerTargetGrid(game->player_target_grid, game->last_shot_coord, false); 
-        displayShipStatusAndStats(game); 
-        printf("\n====================================================\n");
-        printf("    CONGRATULATIONS! You sunk all enemy ships!    \n");
-        printf("====================================================\n");
-        printf("Total missiles fired: %d\n", game->missiles_fired_count);
-        if (game->missiles_fired_count == 17) { 
-            printf("A PERFECT GAME! You used the minimum possible missiles!\n");
+    snprintf(shot_input_str, sizeof(shot_input_str), "%s", line);
+    normalizeShotInput(shot_input_str);
+
+    if (strcmp(shot_input_str, "quit") == 0 || strcmp(shot_input_str, "QUIT") == 0) {
+        printf("Are you sure you want to quit this game session?\n");
+        printf("Save current game before returning to menu? (Y/N): ");
+        play->step = PLAY_AWAIT_SAVE_ON_QUIT;
+        return;
+    }
+
+    parse_err = parseShotCoordinates(shot_input_str, &shot_row, &shot_col);
+    game->last_shot_valid = false; 
+
+    if (parse_err != PARSE_OK) {
+        switch (parse_err) {
+            case PARSE_ERROR_FORMAT: printf("Error: Invalid coordinate format. Use LetterNumber (e.g., A5, J10).\n"); break;
+            case PARSE_ERROR_COL_RANGE: printf("Error: Column out of range. Must be A-J.\n"); break;
+            case PARSE_ERROR_ROW_NAN: printf("Error: Row must be a number.\n"); break;
+            case PARSE_ERROR_ROW_RANGE: printf("Error: Row out of range. Must be 1-10.\n"); break;
+            default: printf("Error: Unknown coordinate parsing error.\n"); break;
         }
-        updateTopScores(game->missiles_fired_count);
-        game->game_in_progress = false;
+        awaitEnter(play, NULL, PLAY_AWAIT_SHOT);
+        return;
+    }
+    
+    game->last_shot_coord.row = shot_row; 
+    game->last_shot_coord.col = shot_col;
+    game->last_shot_valid = true;
 
-        char view_prompt[10];
-        printf("\nWould you like to see the computer's ship placements? (Y/N): ");
-        safeGets(view_prompt, sizeof(view_prompt));
-        if (toupper(view_prompt[0]) == 'Y') {
-            displayComputerOceanGrid_Revealed(game->computer_ocean_grid);
+    if (game->player_target_grid[shot_row][shot_col] != EMPTY_CELL &&
+        game->player_target_grid[shot_row][shot_col] != HIT_CELL) { 
+        printf("You've already conclusively fired at %s (%c). Try a different spot.\n", shot_input_str, game->player_target_grid[shot_row][shot_col]);
+        awaitEnter(play, NULL, PLAY_AWAIT_SHOT);
+        return;
+    }
+
+    int sunk_ship_index = -1;
+    ShotProcessResult result = fireShot(game, shot_row, shot_col, &sunk_ship_index);
+    char result_message[100] = "";
+    publishSpectatorEvent(play->options->broadcast, game, SPECTATE_SHOT, shot_row * GRID_SIZE + shot_col, result, sunk_ship_index);
+    if (play->options->autosave) {
+        if (saveGameStateIncremental(game, &play->shadow)) {
+            play->autosaved = true;
+        } else {
+            printf("Warning: Autosave failed; will retry after the next shot.\n");
         }
     }
-    pauseForKey("Press Enter to return to the Main Menu...");
+
+    switch (result) {
+        case SHOT_MISS:
+            sprintf(result_message, "***** M I S S *****");
+            break;
+        case SHOT_HIT:
+            sprintf(result_message, "***** H I T ! *****");
+            break;
+        case SHOT_SUNK:
+            if (sunk_ship_index != -1) {
+                sprintf(result_message, "***** YOU SUNK THE %s! (%c) *****", game->computer_fleet[sunk_ship_index].name_long, game->computer_fleet[sunk_ship_index].letter);
+            }
+            break;
+        case SHOT_ALREADY_PROCESSED:
+            sprintf(result_message, "You already hit that spot. It's part of a ship (%c).", game->player_target_grid[shot_row][shot_col]);
+            break;
+        case SHOT_ERROR:
+            sprintf(result_message, "Error processing shot. Please report this.");
+            break;
+    }
+    printf("\n%s\n", result_message);
+    awaitEnter(play, "Press Enter for next turn or results...", PLAY_AWAIT_SHOT);
 }
 
 //-----------------------------------------------------------------------------
 // VIII. GAMEPLAY HELPER FUNCTIONS
 //-----------------------------------------------------------------------------
 void displayPlayerTargetGrid(const char grid[GRID_SIZE][GRID_SIZE], Coordinate last_shot, bool highlight_last_shot) {
-    printf("\nYOUR TARGET GRID:\n");
-    printf("  |"); 
+    // Rendered into one buffer so every frame goes out in a single write.
+    char frame[GRID_FRAME_BUFFER_LEN];
+    size_t frame_len = renderTargetGridFrame(frame, sizeof(frame), grid, last_shot, highlight_last_shot);
+    fwrite(frame, 1, frame_len, stdout);
+}
+
+size_t renderTargetGridFrame(char* buffer, size_t buffer_size, const char grid[GRID_SIZE][GRID_SIZE], Coordinate last_shot, bool highlight_last_shot) {
+    size_t len = 0;
+    len += snprintf(buffer + len, buffer_size - len, "\nYOUR TARGET GRID:\n  |");
     for (int c = 0; c < GRID_SIZE; ++c) {
-        printf(" %c |", numberToLetter(c));
+        len += snprintf(buffer + len, buffer_size - len, " %c |", numberToLetter(c));
     }
-    printf("\n");
-    printf("  +");
-    for (int c = 0; c < GRID_SIZE; ++c) printf("---+"); printf("\n");
+    len += snprintf(buffer + len, buffer_size - len, "\n  +");
+    for (int c = 0; c < GRID_SIZE; ++c) len += snprintf(buffer + len, buffer_size - len, "---+");
+    len += snprintf(buffer + len, buffer_size - len, "\n");
 
     for (int r = 0; r < GRID_SIZE; ++r) {
-        printf("%2d|", r + 1); 
+        len += snprintf(buffer + len, buffer_size - len, "%2d|", r + 1);
         for (int c = 0; c < GRID_SIZE; ++c) {
             char display_char = grid[r][c];
             bool is_last_shot = highlight_last_shot && r == last_shot.row && c == last_shot.col;
-            
-            if (is_last_shot) printf("[%c]", display_char);
-            else printf(" %c ", display_char);
-            printf("|");
+
+            if (is_last_shot) len += snprintf(buffer + len, buffer_size - len, "[%c]|", display_char);
+            else len += snprintf(buffer + len, buffer_size - len, " %c |", display_char);
         }
-        printf("\n");
-        printf("  +");
-        for (int c = 0; c < GRID_SIZE; ++c) printf("---+"); printf("\n");
+        len += snprintf(buffer + len, buffer_size - len, "\n  +");
+        for (int c = 0; c < GRID_SIZE; ++c) len += snprintf(buffer + len, buffer_size - len, "---+");
+        len += snprintf(buffer + len, buffer_size - len, "\n");
     }
-    printf("---------------------------------------\n");
+    len += snprintf(buffer + len, buffer_size - len, "---------------------------------------\n");
+    return len;
 }
 
 void displayShipStatusAndStats(const GameState *game) {
@@ -542,13 +1369,10 @@ void displayComputerOceanGrid_Revealed(const char grid[GRID_SIZE][GRID_SIZE]) {
         for (int c = 0; c < GRID_SIZE; ++c) printf("---+"); printf("\n");
     }
     printf("---------------------------------------\n");
-    pauseForKey("This was the computer's setup. Press Enter to continue...");
 }
 
 
-void getPlayerShotInput(char* buffer, int buffer_size, const char* prompt) {
-    printf("%s", prompt);
-    safeGets(buffer, buffer_size);
+void normalizeShotInput(char* buffer) {
     if (strcmp(buffer, "quit") != 0 && strcmp(buffer, "QUIT") != 0) {
         for (int i = 0; buffer[i]; i++) {
             buffer[i] = toupper(buffer[i]);
@@ -556,6 +1380,25 @@ void getPlayerShotInput(char* buffer, int buffer_size, const char* prompt) {
     }
 }
 
+// Returns false if the player types nothing for timeout_seconds. Only
+// terminals are timed; piped input and a timeout of 0 wait indefinitely.
+bool waitForPlayerInput(int timeout_seconds) {
+    #ifdef _WIN32
+        (void)timeout_seconds;
+        return true;
+    #else
+        if (timeout_seconds <= 0 || !isatty(STDIN_FILENO)) return true;
+        fflush(stdout);
+
+        struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+        int ready;
+        do {
+            ready = poll(&input, 1, timeout_seconds * 1000);
+        } while (ready < 0 && errno == EINTR);
+        return ready != 0;
+    #endif
+}
+
 ShotParseError parseShotCoordinates(const char* shot_str, int* r, int* c) {
     if (shot_str == NULL || strlen(shot_str) < 2 || strlen(shot_str) > 3) return PARSE_ERROR_FORMAT;
 
@@ -630,6 +1473,45 @@ ShotProcessResult processPlayerShot(GameState *game, int r_shot, int c_shot) {
     return SHOT_ERROR;
 }
 
+// Counts the missile, resolves it against the computer's grid and records
+// the outcome on the player's target grid. Shared by playGame and self-play.
+ShotProcessResult fireShot(GameState *game, int r_shot, int c_shot, int *sunk_ship_index) {
+    game->missiles_fired_count++;
+    if (game->shot_history_count < MAX_SHOT_HISTORY) {
+        game->shot_history[game->shot_history_count++] = (unsigned char)(r_shot * GRID_SIZE + c_shot);
+    }
+    ShotProcessResult result = processPlayerShot(game, r_shot, c_shot);
+    *sunk_ship_index = -1;
+
+    switch (result) {
+        case SHOT_MISS:
+            game->player_target_grid[r_shot][c_shot] = MISS_CELL;
+            break;
+        case SHOT_HIT:
+            game->player_target_grid[r_shot][c_shot] = HIT_CELL;
+            break;
+        case SHOT_SUNK:
+            for (int i = 0; i < MAX_SHIPS; ++i) {
+                if (game->computer_fleet[i].is_sunk) {
+                    bool this_ship_hit = false;
+                    for (int k = 0; k < game->computer_fleet[i].size; ++k) {
+                        if (game->computer_fleet[i].segments[k].row == r_shot && game->computer_fleet[i].segments[k].col == c_shot) {
+                            this_ship_hit = true; break;
+                        }
+                    }
+                    if (this_ship_hit) {
+                        *sunk_ship_index = i;
+                        updateTargetGridForSunkShip(game, &game->computer_fleet[i]);
+                        break;
+                    }
+                }
+            }
+            break;
+        default:
+            break;
+    }
+    return result;
+}
 
 void updateTargetGridForSunkShip(GameState *game, const Ship* sunk_ship) {
     for (int i = 0; i < sunk_ship->size; ++i) {
@@ -652,165 +1534,3302 @@ int letterToNumber(char val) {
 // IX. GAME STATE PERSISTENCE FUNCTIONS
 //-----------------------------------------------------------------------------
 bool saveGameState(const GameState *game) {
-    FILE *file = fopen(SAVE_FILE_NAME, "wb");
-    if (file == NULL) {
-        perror("Error opening save file for writing");
-        return false;
-    }
-    size_t written = fwrite(game, sizeof(GameState), 1, file);
-    fclose(file);
-    if (written != 1) {
+    return saveGameStateToFile(game, SAVE_FILE_NAME);
+}
+
+// The file holds the record twice, in slots tagged with a sequence number
+// and a checksum. A full save writes both; an incremental save overwrites
+// only the older one, so a torn update never damages the newest good copy.
+bool saveGameStateToFile(const GameState *game, const char *path) {
+    // The record is the in-memory GameState image; the header lets a later
+    // build refuse a record written with a different layout.
+    unsigned char image[SAVE_HEADER_LEN + 2 * SAVE_SLOT_LEN];
+    memcpy(image, SAVE_MAGIC, 4);
+    putUint32LE(image + 4, SAVE_VERSION);
+    putUint32LE(image + 8, (uint32_t)sizeof(GameState));
+    putSaveSlot(image + SAVE_HEADER_LEN, 0, game);
+    putSaveSlot(image + SAVE_HEADER_LEN + SAVE_SLOT_LEN, 1, game);
+    if (!writeFileAtomically(path, image, sizeof(image))) {
         fprintf(stderr, "Error: Failed to write complete game state to save file.\n");
         return false;
     }
     return true;
 }
 
+void putSaveSlot(unsigned char *slot, uint32_t sequence, const GameState *game) {
+    putUint32LE(slot, sequence);
+    putUint32LE(slot + 4, saveSlotChecksum(sequence, game));
+    memcpy(slot + SAVE_SLOT_HEADER_LEN, game, sizeof(GameState));
+}
+
+// Loads the newest slot whose checksum matches.
 bool loadGameState(GameState *game) {
     FILE *file = fopen(SAVE_FILE_NAME, "rb");
     if (file == NULL) {
         return false; 
     }
-    size_t read_count = fread(game, sizeof(GameState), 1, file);
+    unsigned char header[SAVE_HEADER_LEN];
+    if (fread(header, sizeof(header), 1, file) != 1 || memcmp(header, SAVE_MAGIC, 4) != 0 ||
+        getUint32LE(header + 4) != SAVE_VERSION || getUint32LE(header + 8) != sizeof(GameState)) {
+        fclose(file);
+        fprintf(stderr, "Error: Save file was written by a different version of the game and cannot be resumed.\n");
+        return false;
+    }
+    GameState loaded;
+    bool found = false;
+    uint32_t newest = 0;
+    for (int i = 0; i < 2; ++i) {
+        unsigned char slot_header[SAVE_SLOT_HEADER_LEN];
+        GameState slot;
+        if (fread(slot_header, sizeof(slot_header), 1, file) != 1 || fread(&slot, sizeof(GameState), 1, file) != 1) break;
+        uint32_t sequence = getUint32LE(slot_header);
+        if (getUint32LE(slot_header + 4) != saveSlotChecksum(sequence, &slot) || !isValidGameState(&slot)) continue;
+        if (!found || sequence > newest) {
+            loaded = slot;
+            newest = sequence;
+            found = true;
+        }
+    }
     fclose(file);
-    if (read_count != 1) {
+    if (!found) {
         fprintf(stderr, "Error: Failed to read complete game state from save file or file corrupted.\n");
         return false;
     }
+    *game = loaded;
     game->game_in_progress = true; 
     return true;
 }
 
-//-----------------------------------------------------------------------------
-// X. SCORING FUNCTIONS
-//-----------------------------------------------------------------------------
-void viewTopScores() {
-    clearScreen();
-    printf("--- TOP 10 SCORES ---\n");
-    ScoreEntry scores[10]; 
-    int count = readScoresFromFile(scores, 10);
-
-    if (count == 0) {
-        printf("No scores recorded yet. Be the first!\n");
-    } else {
-        printf("Rank | Name | Score (Missiles) | Date Achieved\n");
-        printf("-----|------|------------------|--------------------\n");
-        for (int i = 0; i < count; ++i) {
-            printf("%-4d | %-4s | %-16d | %s\n", i + 1, scores[i].player_name, scores[i].score_value, scores[i].date_time_achieved);
+// Autosave path. The first call writes the whole file atomically; later
+// calls overwrite the older slot in place: the runs of record bytes that
+// differ from what that slot held (the last two shots' worth), then its
+// sequence number and checksum. There is no fsync, so a crash can lose the
+// latest shots, but a slot torn by one fails its checksum and loading falls
+// back to the other, untouched slot. Struct padding is compared too, which
+// at worst lengthens a run.
+bool saveGameStateIncremental(const GameState *game, SaveShadow *shadow) {
+#ifdef _WIN32
+    return saveGameStateToFile(game, shadow->path);
+#else
+    if (shadow->fd < 0) {
+        if (!saveGameStateToFile(game, shadow->path)) return false;
+        shadow->fd = open(shadow->path, O_WRONLY);
+        if (shadow->fd < 0) {
+            perror("Error reopening save file");
+            return true; // The full save landed; the next shot tries again
         }
+        shadow->sequence = 1;
+        memcpy(&shadow->saved[0], game, sizeof(GameState));
+        memcpy(&shadow->saved[1], game, sizeof(GameState));
+        return true;
     }
-    printf("------------------------------------------------------\n");
-    pauseForKey(NULL);
-}
-
-void updateTopScores(int new_score_value) {
-    ScoreEntry scores[11]; 
-    int count = readScoresFromFile(scores, 10);
 
-    bool qualifies = false;
-    if (count < 10) {
-        qualifies = true;
-    } else if (new_score_value < scores[9].score_value) { 
-        qualifies = true;
+    uint32_t sequence = shadow->sequence + 1;
+    int slot = (int)(sequence & 1);
+    off_t slot_offset = (off_t)(SAVE_HEADER_LEN + slot * SAVE_SLOT_LEN);
+    const unsigned char *current = (const unsigned char *)game;
+    unsigned char *saved = (unsigned char *)&shadow->saved[slot];
+    size_t i = 0;
+    while (i < sizeof(GameState)) {
+        if (current[i] == saved[i]) {
+            i++;
+            continue;
+        }
+        size_t last_changed = i;
+        for (size_t j = i + 1; j < sizeof(GameState) && j - last_changed <= SAVE_MERGE_GAP; j++) {
+            if (current[j] != saved[j]) last_changed = j;
+        }
+        size_t len = last_changed - i + 1;
+        if (pwrite(shadow->fd, current + i, len, slot_offset + SAVE_SLOT_HEADER_LEN + (off_t)i) != (ssize_t)len) {
+            perror("Error updating save file");
+            endIncrementalSaves(shadow); // Start over with a full save next time
+            return false;
+        }
+        memcpy(saved + i, current + i, len);
+        i = last_changed + 1;
     }
 
-    if (qualifies) {
-        char player_name_input[MAX_PLAYER_NAME_LEN + 10]; 
-        printf("\nCongratulations! You've made the Top 10 high scores!\n");
-        do {
-            printf("Enter your initials (3 characters, e.g., ACE): ");
-            safeGets(player_name_input, sizeof(player_name_input));
-            if (strlen(player_name_input) != 3) {
-                printf("Error: Initials must be exactly 3 characters. Please try again.\n");
-            }
-        } while (strlen(player_name_input) != 3);
-        
-        ScoreEntry new_entry;
-        strncpy(new_entry.player_name, player_name_input, MAX_PLAYER_NAME_LEN -1);
-        new_entry.player_name[MAX_PLAYER_NAME_LEN - 1] = '\0';
-        new_entry.score_value = new_score_value;
-        getCurrentDateTimeString(new_entry.date_time_achieved, DATETIME_STR_LEN);
-
-        if (count < 10) {
-            scores[count] = new_entry;
-            count++;
-        } else { 
-            scores[9] = new_entry; 
-        }
-
-        sortScores(scores, count); 
-        
-        writeScoresToFile(scores, count); 
-        printf("Your score has been recorded!\n");
-        viewTopScores(); 
-    } else {
-        printf("Good game! Your score of %d missiles was not quite enough for the Top 10 this time.\n", new_score_value);
+    unsigned char slot_header[SAVE_SLOT_HEADER_LEN];
+    putUint32LE(slot_header, sequence);
+    putUint32LE(slot_header + 4, saveSlotChecksum(sequence, game));
+    if (pwrite(shadow->fd, slot_header, sizeof(slot_header), slot_offset) != (ssize_t)sizeof(slot_header)) {
+        perror("Error updating save file");
+        endIncrementalSaves(shadow);
+        return false;
     }
+    shadow->sequence = sequence;
+    return true;
+#endif
 }
 
-int readScoresFromFile(ScoreEntry scores_array[], int max_scores_to_read) {
-    FILE *file = fopen(SCORE_FILE_NAME, "r");
-    if (file == NULL) {
-        return 0; 
+// FNV-1a over the sequence number and the record bytes as saved.
+uint32_t saveSlotChecksum(uint32_t sequence, const GameState *game) {
+    const unsigned char *bytes = (const unsigned char *)game;
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < 4; ++i) {
+        hash = (hash ^ ((sequence >> (8 * i)) & 0xFF)) * 16777619u;
     }
+    for (size_t i = 0; i < sizeof(GameState); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void endIncrementalSaves(SaveShadow *shadow) {
+#ifndef _WIN32
+    if (shadow->fd >= 0) close(shadow->fd);
+#endif
+    shadow->fd = -1;
+}
+
+// Portable form of a game in progress, independent of struct layout and
+// byte order: the replay encoding (layout + shots), the PositionKey of the
+// target grid, the missile count and the last shot cell (0xFF if none).
+// The key covers shots past MAX_SHOT_HISTORY and doubles as a check.
+size_t encodeSession(const GameState *game, unsigned char *out) {
+    unsigned char replay[REPLAY_MAX_RECORD_LEN];
+    size_t replay_len = encodeReplay(game, replay);
+    size_t len = putVarint(out, (uint32_t)replay_len);
+    memcpy(out + len, replay, replay_len);
+    len += replay_len;
+
+    PositionKey key;
+    encodePosition(game->player_target_grid, &key);
+    memcpy(out + len, key.bytes, POSITION_KEY_LEN);
+    len += POSITION_KEY_LEN;
+    len += putVarint(out + len, (uint32_t)game->missiles_fired_count);
+    out[len++] = game->last_shot_valid ? (unsigned char)(game->last_shot_coord.row * GRID_SIZE + game->last_shot_coord.col) : 0xFF;
+    return len;
+}
+
+bool decodeSession(const unsigned char *in, size_t len, GameState *game) {
+    uint32_t replay_len;
+    size_t pos = getVarint(in, len, &replay_len);
+    if (pos == 0 || replay_len > len - pos || !decodeReplay(in + pos, replay_len, game)) return false;
+    pos += replay_len;
+    if (len - pos < POSITION_KEY_LEN + 2) return false;
+
+    PositionKey key;
+    memcpy(key.bytes, in + pos, POSITION_KEY_LEN);
+    pos += POSITION_KEY_LEN;
+
+    // Shots past the history limit are not in the replay; replay them from the key.
+    for (int r = 0; r < GRID_SIZE; ++r) {
+        for (int c = 0; c < GRID_SIZE; ++c) {
+            if (getPositionCell(&key, r, c) != POSITION_UNKNOWN && game->player_target_grid[r][c] == EMPTY_CELL) {
+                int sunk_ship_index;
+                fireShot(game, r, c, &sunk_ship_index);
+            }
+        }
+    }
+    PositionKey rebuilt;
+    encodePosition(game->player_target_grid, &rebuilt);
+    if (memcmp(rebuilt.bytes, key.bytes, POSITION_KEY_LEN) != 0) return false;
+
+    uint32_t missiles;
+    size_t used = getVarint(in + pos, len - pos, &missiles);
+    if (used == 0 || len - pos - used != 1 || missiles < (uint32_t)game->shot_history_count) return false;
+    pos += used;
+    game->missiles_fired_count = (int)missiles;
+    game->last_shot_valid = in[pos] < GRID_SIZE * GRID_SIZE;
+    game->last_shot_coord.row = game->last_shot_valid ? in[pos] / GRID_SIZE : 0;
+    game->last_shot_coord.col = game->last_shot_valid ? in[pos] % GRID_SIZE : 0;
+    game->game_in_progress = game->ships_remaining_count > 0;
+    return true;
+}
+
+// Replaces `path` with `data` using one write to a temporary file, an fsync
+// and a rename, so a crash mid-save leaves either the old file or the new
+// one, never a torn mix of both.
+bool writeFileAtomically(const char *path, const void *data, size_t len) {
+    char temp_path[256];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) return false;
+#ifdef _WIN32
+    FILE *file = fopen(temp_path, "wb");
+    if (file == NULL) {
+        perror("Error opening temporary file for writing");
+        return false;
+    }
+    bool ok = fwrite(data, 1, len, file) == len;
+    if (fclose(file) != 0) ok = false;
+    if (ok) {
+        remove(path); // rename does not replace an existing file on Windows
+        ok = rename(temp_path, path) == 0;
+    }
+#else
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("Error opening temporary file for writing");
+        return false;
+    }
+    const unsigned char *bytes = data;
+    size_t done = 0;
+    bool ok = true;
+    while (done < len) {
+        ssize_t n = write(fd, bytes + done, len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ok = false;
+            break;
+        }
+        done += (size_t)n;
+    }
+    if (ok && fsync(fd) != 0) ok = false;
+    if (close(fd) != 0) ok = false;
+    if (ok) ok = rename(temp_path, path) == 0;
+#endif
+    if (!ok) {
+        perror("Error replacing file");
+        remove(temp_path);
+    }
+    return ok;
+}
+
+// Range checks on a loaded record, so a damaged file cannot send counters
+// or coordinates outside the arrays they index.
+bool isValidGameState(const GameState *game) {
+    if (game->missiles_fired_count < 0 || game->ships_remaining_count < 0 ||
+        game->ships_remaining_count > MAX_SHIPS ||
+        game->shot_history_count < 0 || game->shot_history_count > MAX_SHOT_HISTORY) {
+        return false;
+    }
+    for (int i = 0; i < game->shot_history_count; i++) {
+        if (game->shot_history[i] >= GRID_SIZE * GRID_SIZE) return false;
+    }
+    for (int i = 0; i < MAX_SHIPS; i++) {
+        const Ship *ship = &game->computer_fleet[i];
+        if (ship->size < 1 || ship->size > 5 || ship->hits_taken < 0 || ship->hits_taken > ship->size) return false;
+        for (int j = 0; j < ship->size; j++) {
+            if (ship->segments[j].row < 0 || ship->segments[j].row >= GRID_SIZE ||
+                ship->segments[j].col < 0 || ship->segments[j].col >= GRID_SIZE) return false;
+        }
+    }
+    if (game->last_shot_valid &&
+        (game->last_shot_coord.row < 0 || game->last_shot_coord.row >= GRID_SIZE ||
+         game->last_shot_coord.col < 0 || game->last_shot_coord.col >= GRID_SIZE)) return false;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// X. SCORING FUNCTIONS
+//-----------------------------------------------------------------------------
+void viewTopScores() {
+    displayTopScores();
+    pauseForKey(NULL);
+}
+
+void displayTopScores() {
+    clearScreen();
+    printf("--- TOP 10 SCORES ---\n");
+    ScoreEntry scores[10]; 
+    int count = readScoresFromFile(scores, 10);
+
+    if (count == 0) {
+        printf("No scores recorded yet. Be the first!\n");
+    } else {
+        printf("Rank | Name | Score (Missiles) | Date Achieved\n");
+        printf("-----|------|------------------|--------------------\n");
+        for (int i = 0; i < count; ++i) {
+            printf("%-4d | %-4s | %-16d | %s\n", i + 1, scores[i].player_name, scores[i].score_value, scores[i].date_time_achieved);
+        }
+    }
+    printf("------------------------------------------------------\n");
+}
+
+int readScoresFromFile(ScoreEntry scores_array[], int max_scores_to_read) {
+    FILE *file = fopen(SCORE_FILE_NAME, "r");
+    if (file == NULL) {
+        return 0; 
+    }
+
+    int num_scores = 0;
+    while (num_scores < max_scores_to_read &&
+           fscanf(file, "%3s %d %19[^\n]", 
+                  scores_array[num_scores].player_name,
+                  &scores_array[num_scores].score_value,
+                  scores_array[num_scores].date_time_achieved) == 3) {
+        scores_array[num_scores].player_name[MAX_PLAYER_NAME_LEN - 1] = '\0'; 
+        scores_array[num_scores].date_time_achieved[DATETIME_STR_LEN - 1] = '\0'; 
+        num_scores++;
+    }
+    fclose(file);
+
+    sortScores(scores_array, num_scores); 
+    return num_scores;
+}
+
+void writeScoresToFile(const ScoreEntry scores_array[], int count) {
+    char text[16 * (MAX_PLAYER_NAME_LEN + DATETIME_STR_LEN + 16)];
+    size_t len = 0;
+    for (int i = 0; i < count && i < 16; ++i) {
+        len += (size_t)snprintf(text + len, sizeof(text) - len, "%s %d %s\n", scores_array[i].player_name, scores_array[i].score_value, scores_array[i].date_time_achieved);
+    }
+    if (!writeFileAtomically(SCORE_FILE_NAME, text, len)) {
+        fprintf(stderr, "Error: Could not write scores to file.\n");
+    }
+}
+
+bool scoreQualifies(const ScoreEntry scores_array[], int count, int new_score_value) {
+    return count < 10 || new_score_value < scores_array[9].score_value;
+}
+
+// Adds an entry that qualifies, replacing the tenth place if the table is
+// full, and returns the new count.
+int insertScore(ScoreEntry scores_array[], int count, const ScoreEntry *new_entry) {
+    if (count < 10) {
+        scores_array[count] = *new_entry;
+        count++;
+    } else { 
+        scores_array[9] = *new_entry; 
+    }
+    sortScores(scores_array, count); 
+    return count;
+}
+
+void sortScores(ScoreEntry scores_array[], int count) {
+    ScoreEntry temp;
+    for (int i = 0; i < count - 1; ++i) {
+        for (int j = 0; j < count - i - 1; ++j) {
+            if (scores_array[j].score_value > scores_array[j + 1].score_value) {
+                temp = scores_array[j];
+                scores_array[j] = scores_array[j + 1];
+                scores_array[j + 1] = temp;
+            }
+        }
+    }
+}
+
+void getCurrentDateTimeString(char* buffer, int buffer_size) {
+    time_t now = time(NULL);
+    struct tm *tm_info = localtime(&now);
+    strftime(buffer, buffer_size, "%Y-%m-%d %H:%M", tm_info);
+}
+
+
+//-----------------------------------------------------------------------------
+// XI. POSITION ENCODING FUNCTIONS
+//-----------------------------------------------------------------------------
+// Layout: cell (r, c) occupies bits 2*(r*GRID_SIZE+c) .. +1 of the cell bytes,
+// followed by one byte per SHIP_TYPES entry. A sunk ship byte holds its
+// first segment's cell index in the low 7 bits and its orientation
+// (0 = horizontal, 1 = vertical) in the top bit.
+void encodePosition(const char grid[GRID_SIZE][GRID_SIZE], PositionKey *key) {
+    memset(key->bytes, 0, POSITION_CELL_BYTES);
+    for (int i = 0; i < MAX_SHIPS; ++i) {
+        key->bytes[POSITION_CELL_BYTES + i] = POSITION_SHIP_AFLOAT;
+    }
+
+    for (int r = 0; r < GRID_SIZE; ++r) {
+        for (int c = 0; c < GRID_SIZE; ++c) {
+            char cell = grid[r][c];
+            int index = r * GRID_SIZE + c;
+            unsigned char state = POSITION_UNKNOWN;
+
+            if (cell == MISS_CELL) {
+                state = POSITION_MISS;
+            } else if (cell != EMPTY_CELL) {
+                state = POSITION_HIT;
+                for (int i = 0; i < MAX_SHIPS; ++i) {
+                    // Cells are scanned in row-major order, so the first one
+                    // seen for a sunk ship is its top/left segment.
+                    if (cell == SHIP_TYPES[i].letter && key->bytes[POSITION_CELL_BYTES + i] == POSITION_SHIP_AFLOAT) {
+                        int orientation = (c + 1 < GRID_SIZE && grid[r][c + 1] == cell) ? 0 : 1;
+                        key->bytes[POSITION_CELL_BYTES + i] = (unsigned char)(index | (orientation << 7));
+                    }
+                }
+            }
+            key->bytes[index / 4] |= (unsigned char)(state << ((index % 4) * 2));
+        }
+    }
+}
+
+bool decodePosition(const PositionKey *key, char grid[GRID_SIZE][GRID_SIZE]) {
+    for (int r = 0; r < GRID_SIZE; ++r) {
+        for (int c = 0; c < GRID_SIZE; ++c) {
+            switch (getPositionCell(key, r, c)) {
+                case POSITION_UNKNOWN: grid[r][c] = EMPTY_CELL; break;
+                case POSITION_MISS: grid[r][c] = MISS_CELL; break;
+                case POSITION_HIT: grid[r][c] = HIT_CELL; break;
+                default: return false;
+            }
+        }
+    }
+
+    for (int i = 0; i < MAX_SHIPS; ++i) {
+        unsigned char ship_byte = key->bytes[POSITION_CELL_BYTES + i];
+        if (ship_byte == POSITION_SHIP_AFLOAT) continue;
+
+        int r_start = (ship_byte & 0x7F) / GRID_SIZE;
+        int c_start = (ship_byte & 0x7F) % GRID_SIZE;
+        int orientation = ship_byte >> 7;
+        if (r_start >= GRID_SIZE) return false;
+
+        for (int j = 0; j < SHIP_TYPES[i].size; ++j) {
+            int r = r_start;
+            int c = c_start;
+            if (orientation == 0) c += j; else r += j;
+            if (r >= GRID_SIZE || c >= GRID_SIZE || grid[r][c] != HIT_CELL) return false;
+            grid[r][c] = SHIP_TYPES[i].letter;
+        }
+    }
+    return true;
+}
+
+PositionCellState getPositionCell(const PositionKey *key, int r, int c) {
+    int index = r * GRID_SIZE + c;
+    return (PositionCellState)((key->bytes[index / 4] >> ((index % 4) * 2)) & 0x3);
+}
+
+//-----------------------------------------------------------------------------
+// XII. SELF-PLAY FUNCTIONS
+//-----------------------------------------------------------------------------
+void rngSeed(Rng *rng, uint64_t seed) {
+    rng->state = seed;
+}
+
+uint64_t rngNext(Rng *rng) {
+    uint64_t z = (rng->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+int rngBelow(Rng *rng, int bound) {
+    return (int)(rngNext(rng) % (uint64_t)bound);
+}
+
+// Counter-based: game N of a run always gets the same layout, whichever
+// worker or process ends up playing it.
+uint64_t selfPlayGameSeed(uint64_t base_seed, long game_index) {
+    Rng mixer;
+    rngSeed(&mixer, base_seed ^ ((uint64_t)game_index * 0xD1B54A32D192ED03ULL));
+    return rngNext(&mixer);
+}
+
+// Counts, for every unknown cell, the placements of ships still afloat that
+// cover it and are consistent with the grid. Placements through open hits
+// are weighted up so the density focuses on finishing damaged ships.
+void computeTargetDensity(const char grid[GRID_SIZE][GRID_SIZE], int hit_weight, unsigned int density[GRID_SIZE][GRID_SIZE]) {
+    memset(density, 0, sizeof(unsigned int) * GRID_SIZE * GRID_SIZE);
+
+    for (int i = 0; i < MAX_SHIPS; ++i) {
+        const ShipTypeInfo* ship_type = &SHIP_TYPES[i];
+        bool sunk = false;
+        for (int r = 0; r < GRID_SIZE && !sunk; ++r) {
+            for (int c = 0; c < GRID_SIZE; ++c) {
+                if (grid[r][c] == ship_type->letter) { sunk = true; break; }
+            }
+        }
+        if (sunk) continue;
+
+        for (int orientation = 0; orientation < 2; ++orientation) {
+            int max_r = orientation == 0 ? GRID_SIZE : GRID_SIZE - ship_type->size + 1;
+            int max_c = orientation == 0 ? GRID_SIZE - ship_type->size + 1 : GRID_SIZE;
+            for (int r_start = 0; r_start < max_r; ++r_start) {
+                for (int c_start = 0; c_start < max_c; ++c_start) {
+                    int hits_covered = 0;
+                    bool blocked = false;
+                    for (int j = 0; j < ship_type->size && !blocked; ++j) {
+                        char cell = orientation == 0 ? grid[r_start][c_start + j] : grid[r_start + j][c_start];
+                        if (cell == HIT_CELL) hits_covered++;
+                        else if (cell != EMPTY_CELL) blocked = true;
+                    }
+                    if (blocked) continue;
+
+                    unsigned int weight = 1 + (unsigned int)(hit_weight * hits_covered);
+                    for (int j = 0; j < ship_type->size; ++j) {
+                        int r = orientation == 0 ? r_start : r_start + j;
+                        int c = orientation == 0 ? c_start + j : c_start;
+                        if (grid[r][c] == EMPTY_CELL) density[r][c] += weight;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Fires at the highest-density unknown cell. While hunting (no open hits),
+// cells off the parity lattice of the smallest ship afloat keep only
+// parity_weight percent of their density. While targeting, a non-zero
+// target_radius restricts shots to that Manhattan distance of an open hit.
+Coordinate chooseDensityShot(void *context, const char grid[GRID_SIZE][GRID_SIZE]) {
+    const ShooterParams *params = context;
+    unsigned int density[GRID_SIZE][GRID_SIZE];
+    Coordinate best = {-1, -1};
+    unsigned long long best_score = 0;
+    bool best_in_radius = false;
+    bool hunting = true;
+    int smallest_afloat = GRID_SIZE;
+
+    computeTargetDensity(grid, params->hit_weight, density);
+    for (int i = 0; i < MAX_SHIPS; ++i) {
+        bool sunk = false;
+        for (int r = 0; r < GRID_SIZE && !sunk; ++r) {
+            for (int c = 0; c < GRID_SIZE; ++c) {
+                if (grid[r][c] == SHIP_TYPES[i].letter) { sunk = true; break; }
+            }
+        }
+        if (!sunk && SHIP_TYPES[i].size < smallest_afloat) smallest_afloat = SHIP_TYPES[i].size;
+    }
+    for (int r = 0; r < GRID_SIZE; ++r) {
+        for (int c = 0; c < GRID_SIZE; ++c) {
+            if (grid[r][c] == HIT_CELL) hunting = false;
+        }
+    }
+
+    for (int r = 0; r < GRID_SIZE; ++r) {
+        for (int c = 0; c < GRID_SIZE; ++c) {
+            if (grid[r][c] != EMPTY_CELL) continue;
+
+            unsigned long long score = (unsigned long long)density[r][c] * 100;
+            if (hunting && (r + c) % smallest_afloat != 0) {
+                score = (unsigned long long)density[r][c] * (unsigned int)params->parity_weight;
+            }
+
+            bool in_radius = true;
+            if (!hunting && params->target_radius > 0) {
+                in_radius = false;
+                for (int hr = 0; hr < GRID_SIZE && !in_radius; ++hr) {
+                    for (int hc = 0; hc < GRID_SIZE; ++hc) {
+                        if (grid[hr][hc] == HIT_CELL && abs(hr - r) + abs(hc - c) <= params->target_radius) {
+                            in_radius = true; break;
+                        }
+                    }
+                }
+            }
+
+            if (best.row == -1 || (in_radius && !best_in_radius) ||
+                (in_radius == best_in_radius && score > best_score)) {
+                best.row = r;
+                best.col = c;
+                best_score = score;
+                best_in_radius = in_radius;
+            }
+        }
+    }
+    return best;
+}
+
+// Plays a prepared game to the end and returns the missiles it took.
+int playSelfPlayGame(GameState *game, const Shooter *shooter) {
+    while (game->ships_remaining_count > 0 && game->missiles_fired_count < GRID_SIZE * GRID_SIZE) {
+        Coordinate shot = shooter->choose_shot(shooter->context, game->player_target_grid);
+        if (shot.row < 0 || game->player_target_grid[shot.row][shot.col] != EMPTY_CELL) break;
+
+        int sunk_ship_index;
+        fireShot(game, shot.row, shot.col, &sunk_ship_index);
+    }
+    return game->missiles_fired_count;
+}
+
+void buildLegalShotMask(const char grid[GRID_SIZE][GRID_SIZE], unsigned char mask[LEGAL_MASK_BYTES]) {
+    memset(mask, 0, LEGAL_MASK_BYTES);
+    for (int r = 0; r < GRID_SIZE; ++r) {
+        for (int c = 0; c < GRID_SIZE; ++c) {
+            int index = r * GRID_SIZE + c;
+            if (grid[r][c] == EMPTY_CELL) mask[index / 8] |= (unsigned char)(1 << (index % 8));
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// XIII. POST-GAME ANALYSIS FUNCTIONS
+//-----------------------------------------------------------------------------
+// Restores the position before the first missile: same hidden layout,
+// nothing fired yet.
+void rebuildStartingGame(const GameState *game, GameState *start) {
+    *start = *game;
+    for (int r = 0; r < GRID_SIZE; ++r) {
+        for (int c = 0; c < GRID_SIZE; ++c) {
+            start->player_target_grid[r][c] = EMPTY_CELL;
+            start->computer_ocean_grid[r][c] = EMPTY_CELL;
+        }
+    }
+    for (int i = 0; i < MAX_SHIPS; ++i) {
+        Ship *ship = &start->computer_fleet[i];
+        ship->hits_taken = 0;
+        ship->is_sunk = false;
+        for (int j = 0; j < ship->size; ++j) {
+            start->computer_ocean_grid[ship->segments[j].row][ship->segments[j].col] = ship->letter;
+        }
+    }
+    start->missiles_fired_count = 0;
+    start->ships_remaining_count = MAX_SHIPS;
+    start->last_shot_valid = false;
+    start->shot_history_count = 0;
+}
+
+// Replays the recorded shots and grades each one against the placement
+// density of the position it was fired from. The density shooter is the
+// reference: a shot scores 1.0 when it matches the densest unknown cell.
+// Repeat shots at known cells score 0.
+void analyzeShotHistory(const GameState *game, RegretReport *report) {
+    GameState replay;
+    unsigned int density[GRID_SIZE][GRID_SIZE];
+    double total_quality = 0.0;
+
+    rebuildStartingGame(game, &replay);
+    memset(report, 0, sizeof(*report));
+
+    for (int turn = 0; turn < game->shot_history_count; ++turn) {
+        int r_shot = game->shot_history[turn] / GRID_SIZE;
+        int c_shot = game->shot_history[turn] % GRID_SIZE;
+        Coordinate best = {-1, -1};
+        unsigned int best_density = 0;
+
+        computeTargetDensity(replay.player_target_grid, DEFAULT_HIT_WEIGHT, density);
+        for (int r = 0; r < GRID_SIZE; ++r) {
+            for (int c = 0; c < GRID_SIZE; ++c) {
+                if (replay.player_target_grid[r][c] != EMPTY_CELL) continue;
+                if (best.row == -1 || density[r][c] > best_density) {
+                    best.row = r;
+                    best.col = c;
+                    best_density = density[r][c];
+                }
+            }
+        }
+
+        double quality = 0.0;
+        if (replay.player_target_grid[r_shot][c_shot] == EMPTY_CELL && best_density > 0) {
+            quality = (double)density[r_shot][c_shot] / best_density;
+        }
+        total_quality += quality;
+        report->shots_analyzed++;
+
+        if (quality < MISSED_OPPORTUNITY_QUALITY && best.row != -1) {
+            // Keep the worst MAX_MISSED_OPPORTUNITIES, sorted worst first.
+            int slot = report->missed_count < MAX_MISSED_OPPORTUNITIES ? report->missed_count++ : MAX_MISSED_OPPORTUNITIES;
+            while (slot > 0 && report->missed[slot - 1].quality > quality) {
+                if (slot < MAX_MISSED_OPPORTUNITIES) report->missed[slot] = report->missed[slot - 1];
+                slot--;
+            }
+            if (slot < MAX_MISSED_OPPORTUNITIES) {
+                report->missed[slot].turn = turn + 1;
+                report->missed[slot].played.row = r_shot;
+                report->missed[slot].played.col = c_shot;
+                report->missed[slot].best = best;
+                report->missed[slot].quality = quality;
+            }
+        }
+
+        int sunk_ship_index;
+        fireShot(&replay, r_shot, c_shot, &sunk_ship_index);
+    }
+
+    report->efficiency = report->shots_analyzed > 0 ? total_quality / report->shots_analyzed : 0.0;
+}
+
+void displayRegretReport(const RegretReport *report) {
+    if (report->shots_analyzed == 0) return;
+
+    printf("\nSHOT ANALYSIS:\n");
+    printf("---------------------------------------\n");
+    printf("Shot efficiency: %.1f%% (100%% = always fired at the most likely cell)\n", report->efficiency * 100.0);
+    if (report->missed_count == 0) {
+        printf("No missed opportunities. Well played!\n");
+    } else {
+        printf("Biggest missed opportunities:\n");
+        for (int i = 0; i < report->missed_count; ++i) {
+            const MissedOpportunity *missed = &report->missed[i];
+            printf("  Turn %3d: fired %c%d, %c%d was the better shot (%.0f%% as likely)\n", missed->turn,
+                   numberToLetter(missed->played.col), missed->played.row + 1,
+                   numberToLetter(missed->best.col), missed->best.row + 1, missed->quality * 100.0);
+        }
+    }
+    printf("---------------------------------------\n");
+}
+
+//-----------------------------------------------------------------------------
+// XIV. REPLAY ARCHIVE FUNCTIONS
+//-----------------------------------------------------------------------------
+// Archive layout (all integers little-endian):
+//   header : "VBRA", u32 version, u32 games per block
+//   blocks : REPLAY_GAMES_PER_BLOCK consecutive game records each (the last
+//            block may be shorter), written with one fwrite per block
+//   index  : u64 file offset of every block plus one past the last block,
+//            then u32 offset of every game within its block
+//   footer : u64 index offset, u64 game count, "VBRI"
+// With the index loaded, fetching a game is one seek and one read, and the
+// blocks can be streamed front to back for batch jobs.
+bool openReplayArchiveWriter(const char *path, ReplayArchiveWriter *writer) {
+    memset(writer, 0, sizeof(*writer));
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) {
+        perror("Error opening replay archive for writing");
+        return false;
+    }
+    writer->block = malloc((size_t)REPLAY_GAMES_PER_BLOCK * REPLAY_MAX_RECORD_LEN);
+    if (writer->block == NULL) {
+        fprintf(stderr, "Error: Out of memory for replay archive block.\n");
+        fclose(writer->file);
+        return false;
+    }
+
+    unsigned char header[REPLAY_HEADER_LEN];
+    memcpy(header, REPLAY_MAGIC, 4);
+    putUint32LE(header + 4, REPLAY_VERSION);
+    putUint32LE(header + 8, REPLAY_GAMES_PER_BLOCK);
+    if (fwrite(header, sizeof(header), 1, writer->file) != 1) writer->write_failed = true;
+    writer->next_offset = REPLAY_HEADER_LEN;
+    return true;
+}
+
+bool appendReplay(ReplayArchiveWriter *writer, const GameState *game) {
+    if (writer->game_count == writer->game_capacity) {
+        uint64_t new_capacity = writer->game_capacity == 0 ? REPLAY_GAMES_PER_BLOCK : writer->game_capacity * 2;
+        uint32_t *new_offsets = realloc(writer->game_offsets, sizeof(uint32_t) * new_capacity);
+        if (new_offsets == NULL) {
+            writer->write_failed = true;
+            return false;
+        }
+        writer->game_offsets = new_offsets;
+        writer->game_capacity = new_capacity;
+    }
+
+    writer->game_offsets[writer->game_count++] = (uint32_t)writer->block_len;
+    writer->block_len += encodeReplay(game, writer->block + writer->block_len);
+    if (writer->game_count % REPLAY_GAMES_PER_BLOCK == 0) flushReplayBlock(writer);
+    return !writer->write_failed;
+}
+
+void flushReplayBlock(ReplayArchiveWriter *writer) {
+    if (writer->block_len == 0) return;
+    if (writer->block_count == writer->block_capacity) {
+        uint64_t new_capacity = writer->block_capacity == 0 ? 64 : writer->block_capacity * 2;
+        uint64_t *new_offsets = realloc(writer->block_offsets, sizeof(uint64_t) * (new_capacity + 1));
+        if (new_offsets == NULL) {
+            writer->write_failed = true;
+            return;
+        }
+        writer->block_offsets = new_offsets;
+        writer->block_capacity = new_capacity;
+    }
+
+    if (fwrite(writer->block, 1, writer->block_len, writer->file) != writer->block_len) writer->write_failed = true;
+    writer->block_offsets[writer->block_count++] = writer->next_offset;
+    writer->next_offset += writer->block_len;
+    writer->block_len = 0;
+}
+
+bool closeReplayArchiveWriter(ReplayArchiveWriter *writer) {
+    flushReplayBlock(writer);
+
+    unsigned char entry[8];
+    uint64_t index_offset = writer->next_offset;
+    for (uint64_t b = 0; b < writer->block_count && !writer->write_failed; ++b) {
+        putUint64LE(entry, writer->block_offsets[b]);
+        if (fwrite(entry, 8, 1, writer->file) != 1) writer->write_failed = true;
+    }
+    putUint64LE(entry, index_offset);
+    if (fwrite(entry, 8, 1, writer->file) != 1) writer->write_failed = true;
+    for (uint64_t g = 0; g < writer->game_count && !writer->write_failed; ++g) {
+        putUint32LE(entry, writer->game_offsets[g]);
+        if (fwrite(entry, 4, 1, writer->file) != 1) writer->write_failed = true;
+    }
+
+    unsigned char footer[REPLAY_FOOTER_LEN];
+    putUint64LE(footer, index_offset);
+    putUint64LE(footer + 8, writer->game_count);
+    memcpy(footer + 16, REPLAY_INDEX_MAGIC, 4);
+    if (fwrite(footer, sizeof(footer), 1, writer->file) != 1) writer->write_failed = true;
+    if (fclose(writer->file) != 0) writer->write_failed = true;
+
+    free(writer->block);
+    free(writer->block_offsets);
+    free(writer->game_offsets);
+    return !writer->write_failed;
+}
+
+bool openReplayArchive(const char *path, ReplayArchive *archive) {
+    unsigned char header[REPLAY_HEADER_LEN];
+    unsigned char footer[REPLAY_FOOTER_LEN];
+
+    memset(archive, 0, sizeof(*archive));
+    archive->file = fopen(path, "rb");
+    if (archive->file == NULL) {
+        perror("Error opening replay archive");
+        return false;
+    }
+    if (fread(header, sizeof(header), 1, archive->file) != 1 || memcmp(header, REPLAY_MAGIC, 4) != 0 ||
+        getUint32LE(header + 4) != REPLAY_VERSION || getUint32LE(header + 8) == 0 ||
+        fseek(archive->file, -REPLAY_FOOTER_LEN, SEEK_END) != 0 ||
+        fread(footer, sizeof(footer), 1, archive->file) != 1 || memcmp(footer + 16, REPLAY_INDEX_MAGIC, 4) != 0) {
+        fprintf(stderr, "Error: %s is not a version %d replay archive.\n", path, REPLAY_VERSION);
+        closeReplayArchive(archive);
+        return false;
+    }
+
+    uint64_t index_offset = getUint64LE(footer);
+    archive->games_per_block = getUint32LE(header + 8);
+    archive->game_count = getUint64LE(footer + 8);
+    archive->block_count = (archive->game_count + archive->games_per_block - 1) / archive->games_per_block;
+    archive->block_offsets = malloc(sizeof(uint64_t) * (archive->block_count + 1));
+    archive->game_offsets = malloc(sizeof(uint32_t) * (archive->game_count + 1));
+    if (archive->block_offsets == NULL || archive->game_offsets == NULL ||
+        fseek(archive->file, (long)index_offset, SEEK_SET) != 0) {
+        fprintf(stderr, "Error: Could not load the index of %s.\n", path);
+        closeReplayArchive(archive);
+        return false;
+    }
+
+    unsigned char entry[8];
+    bool ok = true;
+    for (uint64_t b = 0; b <= archive->block_count && ok; ++b) {
+        ok = fread(entry, 8, 1, archive->file) == 1;
+        archive->block_offsets[b] = getUint64LE(entry);
+    }
+    for (uint64_t g = 0; g < archive->game_count && ok; ++g) {
+        ok = fread(entry, 4, 1, archive->file) == 1;
+        archive->game_offsets[g] = getUint32LE(entry);
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: The index of %s is truncated.\n", path);
+        closeReplayArchive(archive);
+        return false;
+    }
+    return true;
+}
+
+// Fetches one game with a single seek; the game comes back in its final
+// state, with its full shot history.
+bool readReplay(const ReplayArchive *archive, uint64_t game_index, GameState *game) {
+    unsigned char record[REPLAY_MAX_RECORD_LEN];
+    if (game_index >= archive->game_count) return false;
+
+    uint64_t block = game_index / archive->games_per_block;
+    uint64_t start = archive->block_offsets[block] + archive->game_offsets[game_index];
+    bool last_in_block = game_index + 1 == archive->game_count || (game_index + 1) % archive->games_per_block == 0;
+    uint64_t end = last_in_block ? archive->block_offsets[block + 1]
+                                 : archive->block_offsets[block] + archive->game_offsets[game_index + 1];
+    if (end <= start || end - start > REPLAY_MAX_RECORD_LEN) return false;
+
+    size_t len = (size_t)(end - start);
+    if (fseek(archive->file, (long)start, SEEK_SET) != 0 || fread(record, 1, len, archive->file) != len) return false;
+    return decodeReplay(record, len, game);
+}
+
+void closeReplayArchive(ReplayArchive *archive) {
+    if (archive->file != NULL) fclose(archive->file);
+    free(archive->block_offsets);
+    free(archive->game_offsets);
+    archive->file = NULL;
+    archive->block_offsets = NULL;
+    archive->game_offsets = NULL;
+}
+
+// Game record: one layout byte per ship (start cell, orientation in the top
+// bit, as in PositionKey), a varint shot count, then each shot as the
+// zigzag varint of its cell index minus the previous shot's.
+size_t encodeReplay(const GameState *game, unsigned char *out) {
+    size_t len = 0;
+    int previous_cell = 0;
+
+    for (int i = 0; i < MAX_SHIPS; ++i) {
+        const Ship *ship = &game->computer_fleet[i];
+        int orientation = ship->segments[1].row == ship->segments[0].row ? 0 : 1;
+        out[len++] = (unsigned char)((ship->segments[0].row * GRID_SIZE + ship->segments[0].col) | (orientation << 7));
+    }
+    len += putVarint(out + len, (uint32_t)game->shot_history_count);
+    for (int i = 0; i < game->shot_history_count; ++i) {
+        int delta = game->shot_history[i] - previous_cell;
+        len += putVarint(out + len, (uint32_t)(delta >= 0 ? 2 * delta : -2 * delta - 1));
+        previous_cell = game->shot_history[i];
+    }
+    return len;
+}
+
+bool decodeReplay(const unsigned char *in, size_t len, GameState *game) {
+    if (len < MAX_SHIPS) return false;
+
+    // Start from an empty board, then place the recorded layout.
+    memset(game, 0, sizeof(*game));
+    for (int r = 0; r < GRID_SIZE; ++r) {
+        for (int c = 0; c < GRID_SIZE; ++c) {
+            game->player_target_grid[r][c] = EMPTY_CELL;
+            game->computer_ocean_grid[r][c] = EMPTY_CELL;
+        }
+    }
+    for (int i = 0; i < MAX_SHIPS; ++i) {
+        Ship *ship = &game->computer_fleet[i];
+        int start = in[i] & 0x7F;
+        int orientation = in[i] >> 7;
+        strcpy(ship->name_long, SHIP_TYPES[i].name_long);
+        ship->letter = SHIP_TYPES[i].letter;
+        ship->size = SHIP_TYPES[i].size;
+        if (start >= GRID_SIZE * GRID_SIZE ||
+            !isValidShipPlacement(game->computer_ocean_grid, &SHIP_TYPES[i], start / GRID_SIZE, start % GRID_SIZE, orientation)) {
+            return false;
+        }
+        for (int j = 0; j < ship->size; ++j) {
+            ship->segments[j].row = start / GRID_SIZE + (orientation == 1 ? j : 0);
+            ship->segments[j].col = start % GRID_SIZE + (orientation == 0 ? j : 0);
+            game->computer_ocean_grid[ship->segments[j].row][ship->segments[j].col] = ship->letter;
+        }
+    }
+    game->ships_remaining_count = MAX_SHIPS;
+
+    size_t pos = MAX_SHIPS;
+    uint32_t shot_count;
+    size_t used = getVarint(in + pos, len - pos, &shot_count);
+    if (used == 0 || shot_count > MAX_SHOT_HISTORY) return false;
+    pos += used;
+
+    int cell = 0;
+    for (uint32_t i = 0; i < shot_count; ++i) {
+        uint32_t zigzag;
+        used = getVarint(in + pos, len - pos, &zigzag);
+        if (used == 0) return false;
+        pos += used;
+        cell += (zigzag & 1) ? -(int)((zigzag + 1) / 2) : (int)(zigzag / 2);
+        if (cell < 0 || cell >= GRID_SIZE * GRID_SIZE) return false;
+
+        int sunk_ship_index;
+        fireShot(game, cell / GRID_SIZE, cell % GRID_SIZE, &sunk_ship_index);
+    }
+    game->game_in_progress = game->ships_remaining_count > 0;
+    return pos == len;
+}
+
+void buildReplaySeeker(const GameState *game, ReplaySeeker *seeker) {
+    GameState replay;
+    seeker->final_game = *game;
+    seeker->move_count = game->shot_history_count;
+    seeker->snapshot_count = 0;
+
+    rebuildStartingGame(game, &replay);
+    for (int move = 0; move <= seeker->move_count; ++move) {
+        if (move % REPLAY_SNAPSHOT_INTERVAL == 0) seeker->snapshots[seeker->snapshot_count++] = replay;
+        if (move == seeker->move_count) break;
+
+        int sunk_ship_index;
+        fireShot(&replay, game->shot_history[move] / GRID_SIZE, game->shot_history[move] % GRID_SIZE, &sunk_ship_index);
+    }
+}
+
+// Restores the position after the first `move` shots.
+void seekReplay(const ReplaySeeker *seeker, int move, GameState *at) {
+    if (move < 0) move = 0;
+    if (move > seeker->move_count) move = seeker->move_count;
+
+    *at = seeker->snapshots[move / REPLAY_SNAPSHOT_INTERVAL];
+    for (int i = at->shot_history_count; i < move; ++i) {
+        int sunk_ship_index;
+        int cell = seeker->final_game.shot_history[i];
+        fireShot(at, cell / GRID_SIZE, cell % GRID_SIZE, &sunk_ship_index);
+    }
+    if (move > 0) {
+        at->last_shot_coord.row = seeker->final_game.shot_history[move - 1] / GRID_SIZE;
+        at->last_shot_coord.col = seeker->final_game.shot_history[move - 1] % GRID_SIZE;
+    }
+    at->last_shot_valid = move > 0;
+}
+
+size_t putVarint(unsigned char *out, uint32_t value) {
+    size_t len = 0;
+    while (value >= 0x80) {
+        out[len++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[len++] = (unsigned char)value;
+    return len;
+}
+
+// Returns the bytes consumed, or 0 if the varint is truncated or too long.
+size_t getVarint(const unsigned char *in, size_t len, uint32_t *value) {
+    *value = 0;
+    for (size_t i = 0; i < len && i < 5; ++i) {
+        *value |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+        if ((in[i] & 0x80) == 0) return i + 1;
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// XV. LEARNED SHOOTER FUNCTIONS
+//-----------------------------------------------------------------------------
+// Weights file layout (all values little-endian):
+//   "VBNN", u32 version, u32 layer count
+//   per layer: u32 inputs, u32 outputs, outputs x inputs f32 weights
+//              (row-major, one row per output), outputs f32 biases
+// The first layer takes MODEL_INPUT_LEN inputs (see encodeModelInput), each
+// layer takes the previous layer's outputs, and the last layer has one
+// output per cell.
+bool loadLearnedModel(const char *path, LearnedModel *model) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror("Error opening model weights file");
+        return false;
+    }
+
+    unsigned char header[12];
+    memset(model, 0, sizeof(*model));
+    if (fread(header, sizeof(header), 1, file) != 1 || memcmp(header, MODEL_MAGIC, 4) != 0 ||
+        getUint32LE(header + 4) != MODEL_VERSION) {
+        fprintf(stderr, "Error: %s is not a version %d model weights file.\n", path, MODEL_VERSION);
+        fclose(file);
+        return false;
+    }
+    model->layer_count = (int)getUint32LE(header + 8);
+    if (model->layer_count < 1 || model->layer_count > MODEL_MAX_LAYERS) {
+        fprintf(stderr, "Error: Model must have 1 to %d layers.\n", MODEL_MAX_LAYERS);
+        fclose(file);
+        return false;
+    }
+
+    // First pass over the layer headers sizes the single allocation.
+    long data_start = ftell(file);
+    size_t total_floats = 0;
+    int expected_inputs = MODEL_INPUT_LEN;
+    for (int i = 0; i < model->layer_count; ++i) {
+        unsigned char dims[8];
+        if (fread(dims, sizeof(dims), 1, file) != 1) {
+            fprintf(stderr, "Error: Model weights file %s is truncated.\n", path);
+            fclose(file);
+            return false;
+        }
+        int inputs = (int)getUint32LE(dims);
+        int outputs = (int)getUint32LE(dims + 4);
+        bool last = i == model->layer_count - 1;
+        if (inputs != expected_inputs || outputs < 1 || outputs > MODEL_MAX_WIDTH ||
+            (last && outputs != GRID_SIZE * GRID_SIZE)) {
+            fprintf(stderr, "Error: Layer %d has unexpected shape %d x %d.\n", i + 1, outputs, inputs);
+            fclose(file);
+            return false;
+        }
+        model->input_len[i] = (inputs + MODEL_LANES - 1) / MODEL_LANES * MODEL_LANES;
+        model->output_len[i] = outputs;
+        total_floats += (size_t)model->input_len[i] * outputs + outputs;
+        expected_inputs = outputs;
+        if (fseek(file, (long)((size_t)inputs * outputs + outputs) * 4, SEEK_CUR) != 0) {
+            perror("Error reading model weights file");
+            fclose(file);
+            return false;
+        }
+    }
+
+    model->storage = calloc(total_floats, sizeof(float));
+    if (model->storage == NULL) {
+        fprintf(stderr, "Error: Out of memory for model weights.\n");
+        fclose(file);
+        return false;
+    }
+
+    float *next = model->storage;
+    bool ok = data_start >= 0 && fseek(file, data_start, SEEK_SET) == 0;
+    for (int i = 0; i < model->layer_count && ok; ++i) {
+        int inputs = i == 0 ? MODEL_INPUT_LEN : model->output_len[i - 1];
+        unsigned char value[4];
+        float *layer_weights = next;
+        float *layer_biases = next + (size_t)model->input_len[i] * model->output_len[i];
+
+        ok = fseek(file, 8, SEEK_CUR) == 0;
+        for (int o = 0; o < model->output_len[i] && ok; ++o) {
+            for (int in = 0; in < inputs && ok; ++in) {
+                ok = fread(value, sizeof(value), 1, file) == 1;
+                layer_weights[(size_t)o * model->input_len[i] + in] = getFloat32LE(value);
+            }
+        }
+        for (int o = 0; o < model->output_len[i] && ok; ++o) {
+            ok = fread(value, sizeof(value), 1, file) == 1;
+            layer_biases[o] = getFloat32LE(value);
+        }
+        model->weights[i] = layer_weights;
+        model->biases[i] = layer_biases;
+        next = layer_biases + model->output_len[i];
+    }
+    fclose(file);
+
+    if (!ok) {
+        fprintf(stderr, "Error: Model weights file %s is truncated.\n", path);
+        freeLearnedModel(model);
+        return false;
+    }
+    return true;
+}
+
+void freeLearnedModel(LearnedModel *model) {
+    free(model->storage);
+    model->storage = NULL;
+    model->layer_count = 0;
+}
+
+// Activations live on the stack, so a loaded model can be shared by every
+// worker thread and a move never allocates.
+Coordinate chooseLearnedShot(void *context, const char grid[GRID_SIZE][GRID_SIZE]) {
+    const LearnedModel *model = context;
+    float activations[2][MODEL_MAX_WIDTH > MODEL_INPUT_LEN ? MODEL_MAX_WIDTH : MODEL_INPUT_LEN];
+    Coordinate best = {-1, -1};
+    float best_logit = 0.0f;
+    int current = 0;
+
+    encodeModelInput(grid, activations[0]);
+    for (int i = 0; i < model->layer_count; ++i) {
+        bool last = i == model->layer_count - 1;
+        float *output = activations[1 - current];
+        denseLayerForward(model->weights[i], model->biases[i], activations[current], output,
+                          model->input_len[i], model->output_len[i], !last);
+        if (!last) {
+            // Zero the padding so the next layer's padded columns contribute nothing.
+            for (int k = model->output_len[i]; k < model->input_len[i + 1]; ++k) output[k] = 0.0f;
+        }
+        current = 1 - current;
+    }
+
+    for (int r = 0; r < GRID_SIZE; ++r) {
+        for (int c = 0; c < GRID_SIZE; ++c) {
+            float logit = activations[current][r * GRID_SIZE + c];
+            if (grid[r][c] != EMPTY_CELL) continue;
+            if (best.row == -1 || logit > best_logit) {
+                best.row = r;
+                best.col = c;
+                best_logit = logit;
+            }
+        }
+    }
+    return best;
+}
+
+void encodeModelInput(const char grid[GRID_SIZE][GRID_SIZE], float input[MODEL_INPUT_LEN]) {
+    const int plane = GRID_SIZE * GRID_SIZE;
+    memset(input, 0, sizeof(float) * MODEL_INPUT_LEN);
+    for (int r = 0; r < GRID_SIZE; ++r) {
+        for (int c = 0; c < GRID_SIZE; ++c) {
+            int index = r * GRID_SIZE + c;
+            char cell = grid[r][c];
+            if (cell == EMPTY_CELL) input[index] = 1.0f;
+            else if (cell == MISS_CELL) input[plane + index] = 1.0f;
+            else if (cell == HIT_CELL) input[2 * plane + index] = 1.0f;
+            else input[3 * plane + index] = 1.0f;
+        }
+    }
+}
+
+// Kernel picked by selectVectorKernels; the portable one until then.
+DenseLayerKernel dense_layer_kernel = denseLayerForwardPortable;
+
+// output = weights * input + biases. Rows are padded to MODEL_LANES floats
+// and summed in MODEL_LANES independent lanes, which the compiler maps onto
+// the target's vector registers without needing intrinsics. The variants
+// differ only in instruction set and in how many rows share a pass; none
+// reorders a lane's additions, so all of them give bit-identical outputs.
+void denseLayerForward(const float *weights, const float *biases, const float *input, float *output, int input_len, int output_len, bool apply_relu) {
+    dense_layer_kernel(weights, biases, input, output, input_len, output_len, apply_relu);
+}
+
+// Shared body of the kernels: one output row at a time.
+static inline __attribute__((always_inline)) void denseLayerRows(const float *weights, const float *biases, const float *input, float *output, int input_len, int output_len, bool apply_relu) {
+    for (int o = 0; o < output_len; ++o) {
+        const float *row = weights + (size_t)o * input_len;
+        float lanes[MODEL_LANES] = {0};
+        for (int i = 0; i < input_len; i += MODEL_LANES) {
+            for (int k = 0; k < MODEL_LANES; ++k) lanes[k] += row[i + k] * input[i + k];
+        }
+        float sum = biases[o];
+        for (int k = 0; k < MODEL_LANES; ++k) sum += lanes[k];
+        output[o] = (apply_relu && sum < 0.0f) ? 0.0f : sum;
+    }
+}
+
+void denseLayerForwardPortable(const float *weights, const float *biases, const float *input, float *output, int input_len, int output_len, bool apply_relu) {
+    denseLayerRows(weights, biases, input, output, input_len, output_len, apply_relu);
+}
+
+// AVX2 without FMA: a fused multiply-add rounds once instead of twice and
+// would make results depend on the host.
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+#endif
+void denseLayerForwardAvx2(const float *weights, const float *biases, const float *input, float *output, int input_len, int output_len, bool apply_relu) {
+    // Four rows per pass: one 8-wide register each keeps four add chains in
+    // flight, which 16 AVX registers hold easily and SSE's 8 would spill.
+    int o = 0;
+    for (; o + 4 <= output_len; o += 4) {
+        const float *row0 = weights + (size_t)o * input_len;
+        const float *row1 = row0 + input_len;
+        const float *row2 = row1 + input_len;
+        const float *row3 = row2 + input_len;
+        float lanes0[MODEL_LANES] = {0}, lanes1[MODEL_LANES] = {0}, lanes2[MODEL_LANES] = {0}, lanes3[MODEL_LANES] = {0};
+        for (int i = 0; i < input_len; i += MODEL_LANES) {
+            for (int k = 0; k < MODEL_LANES; ++k) {
+                float x = input[i + k];
+                lanes0[k] += row0[i + k] * x;
+                lanes1[k] += row1[i + k] * x;
+                lanes2[k] += row2[i + k] * x;
+                lanes3[k] += row3[i + k] * x;
+            }
+        }
+        const float *lanes[4] = {lanes0, lanes1, lanes2, lanes3};
+        for (int b = 0; b < 4; ++b) {
+            float sum = biases[o + b];
+            for (int k = 0; k < MODEL_LANES; ++k) sum += lanes[b][k];
+            output[o + b] = (apply_relu && sum < 0.0f) ? 0.0f : sum;
+        }
+    }
+    denseLayerRows(weights + (size_t)o * input_len, biases + o, input, output + o, input_len, output_len - o, apply_relu);
+}
+
+// Picks the kernels for `level` ("portable" or "avx2"), or the best this CPU
+// runs when `level` is NULL. Fails if the CPU cannot run the forced level.
+bool selectVectorKernels(const char *level) {
+    bool has_avx2 = false;
+    #if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        has_avx2 = __builtin_cpu_supports("avx2");
+    #endif
+
+    if (level == NULL) level = has_avx2 ? "avx2" : "portable";
+    if (strcmp(level, "portable") == 0) {
+        dense_layer_kernel = denseLayerForwardPortable;
+    } else if (strcmp(level, "avx2") == 0 && has_avx2) {
+        dense_layer_kernel = denseLayerForwardAvx2;
+    } else {
+        fprintf(stderr, "Error: This CPU cannot run the '%s' kernels (choose portable%s).\n", level, has_avx2 ? " or avx2" : "");
+        return false;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// XVI. SPECTATOR BROADCAST FUNCTIONS
+//-----------------------------------------------------------------------------
+// Maps the shared spectator ring. Game processes create it on demand;
+// spectators only attach to an existing one. The ring is private to the
+// user and outlives any one game, so spectators follow game after game; it
+// stays in /dev/shm until reboot or `rm /dev/shm/valencia_battleship_spectators`.
+// A game that finds a ring of another size or layout (left by another
+// build) removes it and creates a fresh one; a spectator refuses it.
+SpectatorRing *openSpectatorRing(bool create) {
+    #ifdef _WIN32
+        (void)create;
+        return NULL;
+    #else
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            int flags = create ? (O_RDWR | O_CREAT | (attempt > 0 ? O_EXCL : 0)) : O_RDONLY;
+            int fd = shm_open(SPECTATOR_SHM_NAME, flags, 0600);
+            if (fd < 0) return NULL;
+
+            // A brand-new object is empty; any other size is a foreign layout
+            // and must not be mapped, since touching past its end faults.
+            struct stat info;
+            if (fstat(fd, &info) != 0 || (create && info.st_size == 0 && ftruncate(fd, sizeof(SpectatorRing)) != 0)) {
+                close(fd);
+                return NULL;
+            }
+            bool stale = info.st_size != 0 && info.st_size != (off_t)sizeof(SpectatorRing);
+            if (!create && info.st_size == 0) stale = true;
+
+            SpectatorRing *ring = NULL;
+            if (!stale) {
+                void *mapping = mmap(NULL, sizeof(SpectatorRing), create ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+                if (mapping != MAP_FAILED) ring = mapping;
+            }
+            close(fd);
+            if (!stale && ring == NULL) return NULL;
+
+            if (ring != NULL) {
+                if (create) {
+                    // A fresh object is all zeroes; whichever writer arrives first stamps it.
+                    uint32_t expected = 0;
+                    __atomic_compare_exchange_n(&ring->magic, &expected, SPECTATOR_RING_MAGIC, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+                    expected = 0;
+                    __atomic_compare_exchange_n(&ring->slot_count, &expected, SPECTATOR_RING_SLOTS, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+                }
+                if (__atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) == SPECTATOR_RING_MAGIC &&
+                    __atomic_load_n(&ring->slot_count, __ATOMIC_ACQUIRE) == SPECTATOR_RING_SLOTS) {
+                    return ring;
+                }
+                munmap(ring, sizeof(SpectatorRing));
+            }
+            if (!create || attempt > 0) return NULL;
+            shm_unlink(SPECTATOR_SHM_NAME); // Replace the stale ring on the second attempt
+        }
+        return NULL;
+    #endif
+}
+
+void closeSpectatorRing(SpectatorRing *ring) {
+    #ifndef _WIN32
+        if (ring != NULL) munmap(ring, sizeof(SpectatorRing));
+    #else
+        (void)ring;
+    #endif
+}
+
+// Claims the next slot with one atomic add and fills it under the slot's
+// sequence number. Never blocks; a no-op when broadcasting is off.
+void publishSpectatorEvent(SpectatorRing *ring, const GameState *game, SpectatorEventType type, int cell, ShotProcessResult result, int sunk_ship_index) {
+    #ifdef _WIN32
+        (void)ring; (void)game; (void)type; (void)cell; (void)result; (void)sunk_ship_index;
+    #else
+        if (ring == NULL) return;
+
+        uint64_t event = __atomic_fetch_add(&ring->write_count, 1, __ATOMIC_ACQ_REL);
+        SpectatorSlot *slot = &ring->slots[event % SPECTATOR_RING_SLOTS];
+
+        __atomic_store_n(&slot->sequence, 2 * event + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        slot->session_id = (uint32_t)getpid();
+        slot->type = (uint8_t)type;
+        slot->cell = (uint8_t)cell;
+        slot->result = (uint8_t)result;
+        slot->sunk_ship_index = (int8_t)sunk_ship_index;
+        slot->missiles_fired = (uint16_t)game->missiles_fired_count;
+        encodePosition(game->player_target_grid, &slot->position);
+        __atomic_store_n(&slot->sequence, 2 * event + 2, __ATOMIC_RELEASE);
+    #endif
+}
+
+// Follows the ring from the current end and redraws each event's board.
+// Falling behind only costs frames: the cursor jumps to the oldest event
+// still in the ring.
+int runSpectator(const ToolOptions *options) {
+    (void)options;
+    #ifdef _WIN32
+        fprintf(stderr, "Error: Spectating is not available on this platform.\n");
+        return 1;
+    #else
+        SpectatorRing *ring = openSpectatorRing(false);
+        if (ring == NULL) {
+            fprintf(stderr, "Error: No broadcast to watch. Start a game with --broadcast first.\n");
+            return 1;
+        }
+
+        uint64_t cursor = __atomic_load_n(&ring->write_count, __ATOMIC_ACQUIRE);
+        uint64_t dropped = 0;
+        int stalled_ms = 0; // Time spent waiting on the slot at cursor
+        printf("Watching live games. Press Ctrl+C to stop.\n");
+        fflush(stdout);
+
+        while (true) {
+            uint64_t written = __atomic_load_n(&ring->write_count, __ATOMIC_ACQUIRE);
+            if (written - cursor > SPECTATOR_RING_SLOTS) {
+                dropped += written - SPECTATOR_RING_SLOTS - cursor;
+                cursor = written - SPECTATOR_RING_SLOTS;
+                stalled_ms = 0;
+            }
+            if (cursor == written) {
+                struct timespec pause = {0, SPECTATOR_POLL_MS * 1000000L};
+                nanosleep(&pause, NULL);
+                continue;
+            }
+
+            const SpectatorSlot *slot = &ring->slots[cursor % SPECTATOR_RING_SLOTS];
+            uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+            if (sequence < 2 * cursor + 2) {
+                // Claimed but not finished yet; the writer is mid-update, or
+                // died there, in which case the slot is skipped as a gap.
+                if (stalled_ms < SPECTATOR_STALL_MS) {
+                    struct timespec pause = {0, 1000000L};
+                    nanosleep(&pause, NULL);
+                    stalled_ms++;
+                    continue;
+                }
+                dropped++;
+                cursor++;
+                stalled_ms = 0;
+                continue;
+            }
+            stalled_ms = 0;
+            SpectatorSlot event = *slot;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (sequence != 2 * cursor + 2 || __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) != sequence) {
+                dropped++; // Overwritten while we were reading it
+                cursor++;
+                continue;
+            }
+            cursor++;
+
+            char grid[GRID_SIZE][GRID_SIZE];
+            Coordinate last_shot = {event.cell / GRID_SIZE, event.cell % GRID_SIZE};
+            if (!decodePosition(&event.position, grid)) continue;
+
+            clearScreen();
+            printf("LIVE: session %u, missiles fired: %u", event.session_id, event.missiles_fired);
+            if (dropped > 0) printf("  (skipped %llu events)", (unsigned long long)dropped);
+            printf("\n");
+            displayPlayerTargetGrid(grid, last_shot, event.type == SPECTATE_SHOT);
+            switch (event.type) {
+                case SPECTATE_GAME_STARTED: printf("A game has started.\n"); break;
+                case SPECTATE_SHOT:
+                    if (event.result == SHOT_SUNK && event.sunk_ship_index >= 0 && event.sunk_ship_index < MAX_SHIPS) {
+                        printf("%c%d: sunk the %s!\n", numberToLetter(last_shot.col), last_shot.row + 1, SHIP_TYPES[event.sunk_ship_index].name_long);
+                    } else {
+                        printf("%c%d: %s\n", numberToLetter(last_shot.col), last_shot.row + 1, event.result == SHOT_MISS ? "miss" : "hit");
+                    }
+                    break;
+                case SPECTATE_GAME_WON: printf("All ships sunk in %u missiles!\n", event.missiles_fired); break;
+                case SPECTATE_GAME_LEFT: printf("The player left the game.\n"); break;
+                default: break;
+            }
+            fflush(stdout);
+        }
+    #endif
+}
+
+//-----------------------------------------------------------------------------
+// XVII. SOLVER CACHE FUNCTIONS
+//-----------------------------------------------------------------------------
+// Opens or creates an on-disk table of position key -> density shooter
+// shot, mapped shared so every process using the file sees every other
+// process's answers. Inserts are lock-free: a slot is claimed with a CAS on
+// its tag, filled in, then published by storing the key's hash.
+SolverCache *openSolverCache(const char *path, const ShooterParams *params) {
+    #ifdef _WIN32
+        (void)path;
+        (void)params;
+        fprintf(stderr, "Error: The solver cache is not available on this platform.\n");
+        return NULL;
+    #else
+        size_t map_len = sizeof(SolverCacheHeader) + (size_t)SOLVER_CACHE_ENTRIES * sizeof(SolverCacheEntry);
+        bool created = true;
+        int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd < 0 && errno == EEXIST) {
+            created = false;
+            fd = open(path, O_RDWR);
+        }
+        if (fd < 0) {
+            perror("Error opening solver cache");
+            return NULL;
+        }
+        if (created && ftruncate(fd, (off_t)map_len) != 0) {
+            perror("Error sizing solver cache");
+            close(fd);
+            unlink(path);
+            return NULL;
+        }
+        if (!created) {
+            // Another process may still be sizing the file it just created.
+            struct stat info;
+            for (int waited = 0;; ++waited) {
+                if (fstat(fd, &info) != 0) {
+                    perror("Error reading solver cache size");
+                    close(fd);
+                    return NULL;
+                }
+                if ((size_t)info.st_size >= sizeof(SolverCacheHeader) || waited == 100) break;
+                struct timespec pause = {0, 10000000L};
+                nanosleep(&pause, NULL);
+            }
+            map_len = (size_t)info.st_size;
+        }
+        void *map = map_len >= sizeof(SolverCacheHeader) ? mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        close(fd);
+        SolverCache *cache = map == MAP_FAILED ? NULL : calloc(1, sizeof(SolverCache));
+        if (cache == NULL) {
+            fprintf(stderr, "Error: Could not map solver cache %s.\n", path);
+            if (map != MAP_FAILED) munmap(map, map_len);
+            return NULL;
+        }
+        cache->header = map;
+        cache->entries = (SolverCacheEntry *)(cache->header + 1);
+        cache->map_len = map_len;
+        cache->writing_tag = (uint64_t)getpid() << 2 | SOLVER_CACHE_WRITING;
+        #ifdef __linux__
+            // Lookups land on random pages all over the table, so every
+            // probe is a likely TLB miss on 4 KB pages. Huge pages only take
+            // effect for a file on tmpfs (e.g. /dev/shm) with shmem THP
+            // enabled; anywhere else the advice is refused or ignored.
+            cache->huge_pages = madvise(map, map_len, MADV_HUGEPAGE) == 0;
+        #endif
+
+        SolverCacheHeader *header = cache->header;
+        if (created) {
+            header->version = SOLVER_CACHE_VERSION;
+            header->capacity = SOLVER_CACHE_ENTRIES;
+            header->hit_weight = params->hit_weight;
+            header->parity_weight = params->parity_weight;
+            header->target_radius = params->target_radius;
+            __atomic_store_n(&header->magic, SOLVER_CACHE_MAGIC, __ATOMIC_RELEASE);
+            reportSolverCachePages(cache);
+            return cache;
+        }
+
+        for (int waited = 0; __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SOLVER_CACHE_MAGIC && waited < 100; ++waited) {
+            struct timespec pause = {0, 10000000L};
+            nanosleep(&pause, NULL);
+        }
+        uint32_t capacity = header->capacity;
+        if (header->magic != SOLVER_CACHE_MAGIC || header->version != SOLVER_CACHE_VERSION || capacity == 0 ||
+            (capacity & (capacity - 1)) != 0 || map_len != sizeof(SolverCacheHeader) + (size_t)capacity * sizeof(SolverCacheEntry)) {
+            fprintf(stderr, "Error: %s is not a solver cache file.\n", path);
+            closeSolverCache(cache);
+            return NULL;
+        }
+        if (header->hit_weight != params->hit_weight || header->parity_weight != params->parity_weight ||
+            header->target_radius != params->target_radius) {
+            fprintf(stderr, "Error: %s holds answers for different shooter parameters.\n", path);
+            closeSolverCache(cache);
+            return NULL;
+        }
+        reportSolverCachePages(cache);
+        return cache;
+    #endif
+}
+
+void closeSolverCache(SolverCache *cache) {
+    if (cache == NULL) return;
+    #ifndef _WIN32
+        munmap(cache->header, cache->map_len);
+    #endif
+    free(cache);
+}
+
+// Prints the page setup behind the cache mapping: the base page size, the
+// kernel's transparent huge page modes, and whether the advice was taken.
+void reportSolverCachePages(const SolverCache *cache) {
+    #ifndef _WIN32
+        char modes[2][32] = {"unknown", "unknown"};
+        const char *paths[2] = {"/sys/kernel/mm/transparent_hugepage/enabled",
+                                "/sys/kernel/mm/transparent_hugepage/shmem_enabled"};
+        for (int i = 0; i < 2; ++i) {
+            FILE *file = fopen(paths[i], "r");
+            char line[128];
+            if (file == NULL) continue;
+            if (fgets(line, sizeof(line), file) != NULL) {
+                // The active mode is the bracketed word, e.g. "always [madvise] never".
+                char *open_bracket = strchr(line, '[');
+                char *close_bracket = open_bracket != NULL ? strchr(open_bracket, ']') : NULL;
+                if (close_bracket != NULL && close_bracket - open_bracket - 1 < (long)sizeof(modes[i])) {
+                    *close_bracket = '\0';
+                    strcpy(modes[i], open_bracket + 1);
+                }
+            }
+            fclose(file);
+        }
+        printf("Solver cache: %.1f MB mapped, %ld KB base pages, huge pages %s (THP %s, shmem THP %s)\n",
+               (double)cache->map_len / (1024.0 * 1024.0), sysconf(_SC_PAGESIZE) / 1024,
+               cache->huge_pages ? "advised" : "unavailable", modes[0], modes[1]);
+    #else
+        (void)cache;
+    #endif
+}
+
+// Bytes of the mapping starting at address that the kernel currently backs
+// with huge pages, read from /proc/self/smaps. Zero where that is unknown.
+size_t hugePageBytes(const void *address) {
+    size_t bytes = 0;
+    #ifdef __linux__
+        FILE *file = fopen("/proc/self/smaps", "r");
+        if (file == NULL) return 0;
+        char line[256];
+        bool in_mapping = false;
+        while (fgets(line, sizeof(line), file) != NULL) {
+            unsigned long start, end;
+            unsigned long long kb;
+            if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+                if (in_mapping) break;
+                in_mapping = start == (unsigned long)(uintptr_t)address;
+            } else if (in_mapping && (sscanf(line, "AnonHugePages: %llu kB", &kb) == 1 ||
+                                      sscanf(line, "ShmemPmdMapped: %llu kB", &kb) == 1 ||
+                                      sscanf(line, "FilePmdMapped: %llu kB", &kb) == 1)) {
+                bytes += (size_t)kb * 1024;
+            }
+        }
+        fclose(file);
+    #else
+        (void)address;
+    #endif
+    return bytes;
+}
+
+// Open addressing with linear probing. A slot still being written reads as
+// not present, so a racing lookup simply recomputes the shot.
+bool lookupSolverCache(SolverCache *cache, const PositionKey *key, int *best_cell) {
+    uint64_t tag = hashPositionKey(key);
+    uint32_t mask = cache->header->capacity - 1;
+    for (uint32_t probe = 0; probe < SOLVER_CACHE_MAX_PROBES; ++probe) {
+        const SolverCacheEntry *entry = &cache->entries[(tag + probe) & mask];
+        uint64_t seen = __atomic_load_n(&entry->tag, __ATOMIC_ACQUIRE);
+        if (seen == 0) break;
+        if (seen == tag && memcmp(entry->key, key->bytes, POSITION_KEY_LEN) == 0) {
+            *best_cell = entry->best_cell;
+            __atomic_fetch_add(&cache->hits, 1, __ATOMIC_RELAXED);
+            return true;
+        }
+    }
+    __atomic_fetch_add(&cache->misses, 1, __ATOMIC_RELAXED);
+    return false;
+}
+
+void insertSolverCache(SolverCache *cache, const PositionKey *key, int best_cell) {
+    uint64_t tag = hashPositionKey(key);
+    uint32_t mask = cache->header->capacity - 1;
+    for (uint32_t probe = 0; probe < SOLVER_CACHE_MAX_PROBES; ++probe) {
+        SolverCacheEntry *entry = &cache->entries[(tag + probe) & mask];
+        uint64_t seen = 0;
+        bool claimed = __atomic_compare_exchange_n(&entry->tag, &seen, cache->writing_tag, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE);
+        if (!claimed && (seen & 3) == SOLVER_CACHE_WRITING && !solverCacheWriterAlive(seen)) {
+            // Left half-written by a process that died; take it over.
+            claimed = __atomic_compare_exchange_n(&entry->tag, &seen, cache->writing_tag, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE);
+        }
+        if (claimed) {
+            memcpy(entry->key, key->bytes, POSITION_KEY_LEN);
+            entry->best_cell = (uint8_t)best_cell;
+            __atomic_store_n(&entry->tag, tag, __ATOMIC_RELEASE);
+            __atomic_fetch_add(&cache->inserts, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        if (seen == tag && memcmp(entry->key, key->bytes, POSITION_KEY_LEN) == 0) return; // Another process got there first
+    }
+    __atomic_fetch_add(&cache->dropped, 1, __ATOMIC_RELAXED);
+}
+
+// Whether the process that claimed a slot with this writing tag still runs.
+// A recycled pid keeps the slot claimed, which only costs the slot.
+bool solverCacheWriterAlive(uint64_t tag) {
+    #ifdef _WIN32
+        (void)tag;
+        return true;
+    #else
+        pid_t writer = (pid_t)(tag >> 2);
+        return writer <= 0 || kill(writer, 0) == 0 || errno != ESRCH;
+    #endif
+}
+
+// FNV-1a over the key, with bit 1 forced so no tag is 0 or a writing tag.
+uint64_t hashPositionKey(const PositionKey *key) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < POSITION_KEY_LEN; ++i) {
+        hash ^= key->bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash | 2;
+}
+
+Coordinate chooseCachedShot(void *context, const char grid[GRID_SIZE][GRID_SIZE]) {
+    ToolShooter *tool_shooter = context;
+    PositionKey key;
+    int best_cell;
+
+    encodePosition(grid, &key);
+    if (lookupSolverCache(tool_shooter->cache, &key, &best_cell)) {
+        Coordinate cached = {best_cell / GRID_SIZE, best_cell % GRID_SIZE};
+        return cached;
+    }
+    Coordinate shot = tool_shooter->uncached.choose_shot(tool_shooter->uncached.context, grid);
+    if (shot.row >= 0) insertSolverCache(tool_shooter->cache, &key, shot.row * GRID_SIZE + shot.col);
+    return shot;
+}
+
+//-----------------------------------------------------------------------------
+// XVIII. TOURNAMENT FUNCTIONS
+//-----------------------------------------------------------------------------
+// A tournament plays games first_game onwards with the tool shooter and
+// reports how many missiles they took. Game n depends only on
+// selfPlayGameSeed(seed, n) and histograms merge by addition, so a run split
+// across threads, processes or machines, or resumed from a checkpoint,
+// reports exactly the same numbers.
+int runTournament(const ToolOptions *options) {
+    TournamentCoordinator tournament;
+    ToolShooter tool_shooter;
+
+    if (!createToolShooter(options, &tool_shooter)) return 1;
+    if (!startTournamentLeases(&tournament, options)) {
+        freeToolShooter(&tool_shooter);
+        return 1;
+    }
+    // Played lease by lease so a checkpoint can be taken between them.
+    for (long i = 0; i < tournament.lease_count; ++i) {
+        TournamentLease *lease = &tournament.leases[i];
+        if (lease->state == LEASE_DONE) continue;
+        MissileHistogram result;
+        playTournamentRange(&tool_shooter.shooter, options->seed, lease->first_game, lease->game_count, options->thread_count, &result);
+        completeTournamentLease(&tournament, i, &result);
+    }
+    freeToolShooter(&tool_shooter);
+    printTournamentReport(options, &tournament.histogram);
+    if (options->checkpoint_path != NULL) remove(options->checkpoint_path); // The run is complete
+    free(tournament.leases);
+    return 0;
+}
+
+void playTournamentRange(const Shooter *shooter, uint64_t seed, long first_game, long game_count, int thread_count, MissileHistogram *histogram) {
+    TournamentWorker workers[MAX_WORKER_THREADS];
+    int worker_count = thread_count;
+    if (worker_count > game_count) worker_count = game_count > 0 ? (int)game_count : 1;
+
+    memset(workers, 0, sizeof(workers));
+    for (int i = 0; i < worker_count; ++i) {
+        workers[i].shooter = shooter;
+        workers[i].seed = seed;
+        workers[i].first_game = first_game;
+        workers[i].game_count = game_count;
+        workers[i].worker_index = i;
+        workers[i].worker_count = worker_count;
+    }
+    runWorkers(tournamentWorkerMain, workers, sizeof(TournamentWorker), worker_count);
+
+    memset(histogram, 0, sizeof(*histogram));
+    for (int i = 0; i < worker_count; ++i) mergeMissileHistogram(histogram, &workers[i].histogram);
+}
+
+void *tournamentWorkerMain(void *arg) {
+    TournamentWorker *worker = arg;
+    GameState game;
+    Rng rng;
+
+    for (long n = worker->worker_index; n < worker->game_count; n += worker->worker_count) {
+        rngSeed(&rng, selfPlayGameSeed(worker->seed, worker->first_game + n));
+        resetGameState(&game, &rng);
+        worker->histogram.games[playSelfPlayGame(&game, worker->shooter)]++;
+    }
+    return NULL;
+}
+
+void mergeMissileHistogram(MissileHistogram *into, const MissileHistogram *from) {
+    for (int m = 0; m < TOURNAMENT_BINS; ++m) into->games[m] += from->games[m];
+}
+
+// Fewest missiles that at least fraction of the games needed no more than.
+int missilePercentile(const MissileHistogram *histogram, uint64_t games, double fraction) {
+    uint64_t wanted = (uint64_t)ceil(fraction * (double)games);
+    uint64_t seen = 0;
+    if (wanted < 1) wanted = 1;
+    for (int m = 0; m < TOURNAMENT_BINS; ++m) {
+        seen += histogram->games[m];
+        if (seen >= wanted) return m;
+    }
+    return TOURNAMENT_BINS - 1;
+}
+
+void printTournamentReport(const ToolOptions *options, const MissileHistogram *histogram) {
+    uint64_t games = 0, total = 0, total_squares = 0, largest_bucket = 0;
+    uint64_t buckets[TOURNAMENT_BINS / 10 + 1] = {0};
+    int best = -1, worst = -1;
+
+    for (int m = 0; m < TOURNAMENT_BINS; ++m) {
+        uint64_t count = histogram->games[m];
+        if (count == 0) continue;
+        if (best < 0) best = m;
+        worst = m;
+        games += count;
+        total += count * (uint64_t)m;
+        total_squares += count * (uint64_t)(m * m);
+        buckets[m / 10] += count;
+    }
+    printf("Tournament: %llu games with the %s shooter (seed %llu, games %ld-%ld)\n", (unsigned long long)games,
+           options->shooter_name, (unsigned long long)options->seed, options->first_game, options->first_game + options->game_count - 1);
+    if (games == 0) return;
+
+    double mean = (double)total / (double)games;
+    double variance = (double)total_squares / (double)games - mean * mean;
+    printf("  mean %.3f missiles (sd %.3f), best %d, median %d, p90 %d, p99 %d, worst %d\n", mean,
+           variance > 0.0 ? sqrt(variance) : 0.0, best, missilePercentile(histogram, games, 0.5),
+           missilePercentile(histogram, games, 0.9), missilePercentile(histogram, games, 0.99), worst);
+
+    for (int b = 0; b <= TOURNAMENT_BINS / 10; ++b) {
+        if (buckets[b] > largest_bucket) largest_bucket = buckets[b];
+    }
+    printf("  missiles | games\n");
+    for (int b = best / 10; b <= worst / 10; ++b) {
+        int bar = (int)((buckets[b] * 40 + largest_bucket - 1) / largest_bucket);
+        printf("  %3d-%-3d  | %-10llu %.*s\n", b * 10, b * 10 + 9 < TOURNAMENT_BINS - 1 ? b * 10 + 9 : TOURNAMENT_BINS - 1,
+               (unsigned long long)buckets[b], bar, "########################################");
+    }
+}
+
+// Divides the tournament into leases of options->lease_games games and, with
+// --checkpoint, picks up the leases and results of an interrupted run.
+bool startTournamentLeases(TournamentCoordinator *coordinator, const ToolOptions *options) {
+    memset(coordinator, 0, sizeof(*coordinator));
+    coordinator->options = options;
+    coordinator->lease_count = (options->game_count + options->lease_games - 1) / options->lease_games;
+    coordinator->leases = calloc((size_t)coordinator->lease_count, sizeof(TournamentLease));
+    if (coordinator->leases == NULL) {
+        fprintf(stderr, "Error: Not enough memory for %ld leases.\n", coordinator->lease_count);
+        return false;
+    }
+    for (long i = 0; i < coordinator->lease_count; ++i) {
+        long offset = i * options->lease_games;
+        coordinator->leases[i].first_game = options->first_game + offset;
+        coordinator->leases[i].game_count = options->game_count - offset < options->lease_games ? options->game_count - offset : options->lease_games;
+        coordinator->leases[i].state = LEASE_PENDING;
+        coordinator->leases[i].holder = -1;
+    }
+    for (int i = 0; i < TOURNAMENT_MAX_WORKERS; ++i) coordinator->connections[i].fd = -1;
+
+    if (options->checkpoint_path != NULL && !loadTournamentCheckpoint(coordinator)) {
+        free(coordinator->leases);
+        return false;
+    }
+    return true;
+}
+
+void completeTournamentLease(TournamentCoordinator *coordinator, long lease_index, const MissileHistogram *result) {
+    mergeMissileHistogram(&coordinator->histogram, result);
+    coordinator->leases[lease_index].state = LEASE_DONE;
+    coordinator->leases_done++;
+    if (coordinator->options->checkpoint_path != NULL) writeTournamentCheckpoint(coordinator);
+}
+
+// Checkpoint file layout (all integers little-endian):
+//   "VBTC", u32 version, u64 seed, u64 first game, u64 game count,
+//   u64 games per lease, shooter name (16 bytes), the merged histogram
+//   (u64 per missile count), one bit per finished lease.
+// Games are seeded by index, so finished leases plus their merged results
+// are the whole state of a run; there is no generator position to keep.
+bool writeTournamentCheckpoint(const TournamentCoordinator *coordinator) {
+    const ToolOptions *options = coordinator->options;
+    size_t len = TOURNAMENT_CHECKPOINT_HEADER_LEN + (size_t)(coordinator->lease_count + 7) / 8;
+    unsigned char *image = calloc(len, 1);
+    if (image == NULL) return false;
+
+    memcpy(image, TOURNAMENT_CHECKPOINT_MAGIC, 4);
+    putUint32LE(image + 4, TOURNAMENT_CHECKPOINT_VERSION);
+    putUint64LE(image + 8, options->seed);
+    putUint64LE(image + 16, (uint64_t)options->first_game);
+    putUint64LE(image + 24, (uint64_t)options->game_count);
+    putUint64LE(image + 32, (uint64_t)options->lease_games);
+    strncpy((char *)image + 40, options->shooter_name, TOURNAMENT_SHOOTER_NAME_LEN);
+    for (int m = 0; m < TOURNAMENT_BINS; ++m) putUint64LE(image + 56 + 8 * m, coordinator->histogram.games[m]);
+    unsigned char *done = image + TOURNAMENT_CHECKPOINT_HEADER_LEN;
+    for (long i = 0; i < coordinator->lease_count; ++i) {
+        if (coordinator->leases[i].state == LEASE_DONE) done[i / 8] |= (unsigned char)(1 << (i % 8));
+    }
+
+    bool ok = writeFileAtomically(options->checkpoint_path, image, len);
+    free(image);
+    return ok;
+}
+
+// Restores finished leases and their results from options->checkpoint_path.
+// A missing file means a fresh run; one from a different run is an error.
+bool loadTournamentCheckpoint(TournamentCoordinator *coordinator) {
+    const ToolOptions *options = coordinator->options;
+    FILE *file = fopen(options->checkpoint_path, "rb");
+    if (file == NULL) {
+        if (errno == ENOENT) return true;
+        perror("Error opening tournament checkpoint");
+        return false;
+    }
+    size_t len = TOURNAMENT_CHECKPOINT_HEADER_LEN + (size_t)(coordinator->lease_count + 7) / 8;
+    unsigned char *image = malloc(len);
+    bool ok = image != NULL && fread(image, len, 1, file) == 1 && fgetc(file) == EOF &&
+              memcmp(image, TOURNAMENT_CHECKPOINT_MAGIC, 4) == 0 && getUint32LE(image + 4) == TOURNAMENT_CHECKPOINT_VERSION;
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "Error: %s is not a checkpoint of this tournament.\n", options->checkpoint_path);
+        free(image);
+        return false;
+    }
+    char shooter_name[TOURNAMENT_SHOOTER_NAME_LEN + 1];
+    memcpy(shooter_name, image + 40, TOURNAMENT_SHOOTER_NAME_LEN);
+    shooter_name[TOURNAMENT_SHOOTER_NAME_LEN] = '\0';
+    if (getUint64LE(image + 8) != options->seed || getUint64LE(image + 16) != (uint64_t)options->first_game ||
+        getUint64LE(image + 24) != (uint64_t)options->game_count || getUint64LE(image + 32) != (uint64_t)options->lease_games ||
+        strcmp(shooter_name, options->shooter_name) != 0) {
+        fprintf(stderr, "Error: %s was written by a tournament with different options.\n", options->checkpoint_path);
+        free(image);
+        return false;
+    }
+
+    for (int m = 0; m < TOURNAMENT_BINS; ++m) coordinator->histogram.games[m] = getUint64LE(image + 56 + 8 * m);
+    const unsigned char *done = image + TOURNAMENT_CHECKPOINT_HEADER_LEN;
+    for (long i = 0; i < coordinator->lease_count; ++i) {
+        if ((done[i / 8] >> (i % 8)) & 1) {
+            coordinator->leases[i].state = LEASE_DONE;
+            coordinator->leases_done++;
+        }
+    }
+    free(image);
+    printf("Resuming from %s: %ld of %ld leases already played.\n", options->checkpoint_path, coordinator->leases_done, coordinator->lease_count);
+    fflush(stdout);
+    return true;
+}
+
+// Splits the tournament into leases of options->lease_games games and hands
+// them to workers connecting on TCP port options->path. A lease that is not
+// returned within the timeout, or whose worker disconnects, is handed out
+// again; the first result for a range counts and later copies are ignored.
+int runTournamentCoordinator(const ToolOptions *options) {
+    #ifdef _WIN32
+        fprintf(stderr, "Error: Distributed tournaments are not available on this platform.\n");
+        return 1;
+    #else
+        TournamentCoordinator coordinator;
+        struct pollfd polled[TOURNAMENT_MAX_WORKERS + 1];
+        int polled_index[TOURNAMENT_MAX_WORKERS + 1];
+
+        if (!startTournamentLeases(&coordinator, options)) return 1;
+
+        int listener = openTournamentListener(options->path);
+        if (listener < 0) {
+            free(coordinator.leases);
+            return 1;
+        }
+        signal(SIGPIPE, SIG_IGN); // A worker vanishing mid-send is handled as a disconnect
+        printf("Coordinating %ld games in %ld leases on port %s. Start workers with --work HOST:%s.\n",
+               options->game_count, coordinator.lease_count, options->path, options->path);
+        fflush(stdout);
+
+        while (coordinator.leases_done < coordinator.lease_count) {
+            assignTournamentLeases(&coordinator);
+
+            int polled_count = 1;
+            polled[0].fd = listener;
+            polled[0].events = POLLIN;
+            for (int i = 0; i < TOURNAMENT_MAX_WORKERS; ++i) {
+                if (coordinator.connections[i].fd < 0) continue;
+                polled[polled_count].fd = coordinator.connections[i].fd;
+                polled[polled_count].events = POLLIN;
+                polled_index[polled_count++] = i;
+            }
+            if (poll(polled, (nfds_t)polled_count, TOURNAMENT_POLL_MS) < 0 && errno != EINTR) {
+                perror("Error waiting for workers");
+                break;
+            }
+            if (polled[0].revents & POLLIN) acceptTournamentWorker(&coordinator, listener);
+            for (int p = 1; p < polled_count; ++p) {
+                if (polled[p].revents != 0) serviceTournamentConnection(&coordinator, polled_index[p]);
+            }
+
+            uint64_t now = monotonicNanos();
+            for (long i = 0; i < coordinator.lease_count; ++i) {
+                TournamentLease *lease = &coordinator.leases[i];
+                if (lease->state != LEASE_ACTIVE || now < lease->deadline_ns) continue;
+                printf("  games %ld-%ld timed out on worker %d; handing them out again\n", lease->first_game,
+                       lease->first_game + lease->game_count - 1, lease->holder);
+                lease->state = LEASE_PENDING;
+            }
+        }
+
+        // Workers waiting for a lease hear that there is none; workers still
+        // on a timed-out lease just lose the connection.
+        unsigned char finished[TOURNAMENT_LEASE_LEN];
+        memset(finished, 0, sizeof(finished));
+        for (int i = 0; i < TOURNAMENT_MAX_WORKERS; ++i) {
+            CoordinatorConnection *connection = &coordinator.connections[i];
+            if (connection->fd < 0) continue;
+            if (connection->greeted && !connection->awaiting_result) sendAllBytes(connection->fd, finished, sizeof(finished));
+            close(connection->fd);
+        }
+        close(listener);
+        free(coordinator.leases);
+
+        if (coordinator.leases_done < coordinator.lease_count) return 1;
+        printTournamentReport(options, &coordinator.histogram);
+        if (options->checkpoint_path != NULL) remove(options->checkpoint_path); // The run is complete
+        return 0;
+    #endif
+}
+
+// Gives the lowest pending leases to greeted workers that have nothing to do.
+void assignTournamentLeases(TournamentCoordinator *coordinator) {
+    #ifndef _WIN32
+        const ToolOptions *options = coordinator->options;
+        long next = 0;
+        for (int i = 0; i < TOURNAMENT_MAX_WORKERS; ++i) {
+            CoordinatorConnection *connection = &coordinator->connections[i];
+            if (connection->fd < 0 || !connection->greeted || connection->awaiting_result) continue;
+            while (next < coordinator->lease_count && coordinator->leases[next].state != LEASE_PENDING) next++;
+            if (next == coordinator->lease_count) return;
+
+            TournamentLease *lease = &coordinator->leases[next];
+            unsigned char message[TOURNAMENT_LEASE_LEN];
+            putUint64LE(message, options->seed);
+            putUint64LE(message + 8, (uint64_t)lease->first_game);
+            putUint64LE(message + 16, (uint64_t)lease->game_count);
+            if (!sendAllBytes(connection->fd, message, sizeof(message))) {
+                dropTournamentConnection(coordinator, i, "disconnected");
+                continue;
+            }
+            lease->state = LEASE_ACTIVE;
+            lease->holder = i;
+            lease->deadline_ns = monotonicNanos() + (uint64_t)options->lease_timeout_s * 1000000000ULL;
+            connection->lease = next;
+            connection->awaiting_result = true;
+        }
+    #else
+        (void)coordinator;
+    #endif
+}
+
+void acceptTournamentWorker(TournamentCoordinator *coordinator, int listener) {
+    #ifndef _WIN32
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) return;
+        for (int i = 0; i < TOURNAMENT_MAX_WORKERS; ++i) {
+            CoordinatorConnection *connection = &coordinator->connections[i];
+            if (connection->fd >= 0) continue;
+            connection->fd = fd;
+            connection->greeted = false;
+            connection->awaiting_result = false;
+            connection->lease = -1;
+            connection->received = 0;
+            return;
+        }
+        fprintf(stderr, "Turning away a worker: %d are already connected.\n", TOURNAMENT_MAX_WORKERS);
+        close(fd);
+    #else
+        (void)coordinator;
+        (void)listener;
+    #endif
+}
+
+// Reads what is available from a readable worker and acts on each complete
+// message: the hello first, then one result per lease.
+void serviceTournamentConnection(TournamentCoordinator *coordinator, int index) {
+    #ifndef _WIN32
+        const ToolOptions *options = coordinator->options;
+        CoordinatorConnection *connection = &coordinator->connections[index];
+        size_t expected = connection->greeted ? TOURNAMENT_RESULT_LEN : TOURNAMENT_HELLO_LEN;
+        ssize_t got = recv(connection->fd, connection->buffer + connection->received, expected - connection->received, 0);
+        if (got < 0 && errno == EINTR) return;
+        if (got <= 0) {
+            dropTournamentConnection(coordinator, index, "disconnected");
+            return;
+        }
+        connection->received += (size_t)got;
+        if (connection->received < expected) return;
+        connection->received = 0;
+
+        if (!connection->greeted) {
+            char shooter_name[TOURNAMENT_SHOOTER_NAME_LEN + 1];
+            if (memcmp(connection->buffer, TOURNAMENT_MAGIC, 4) != 0 || getUint32LE(connection->buffer + 4) != TOURNAMENT_VERSION) {
+                dropTournamentConnection(coordinator, index, "is not a compatible tournament worker");
+                return;
+            }
+            memcpy(shooter_name, connection->buffer + 8, TOURNAMENT_SHOOTER_NAME_LEN);
+            shooter_name[TOURNAMENT_SHOOTER_NAME_LEN] = '\0';
+            if (strcmp(shooter_name, options->shooter_name) != 0) {
+                dropTournamentConnection(coordinator, index, "plays a different shooter");
+                return;
+            }
+            connection->greeted = true;
+            printf("  worker %d connected\n", index);
+            fflush(stdout);
+            return;
+        }
+
+        long first_game = (long)getUint64LE(connection->buffer);
+        long game_count = (long)getUint64LE(connection->buffer + 8);
+        long lease_index = first_game >= options->first_game ? (first_game - options->first_game) / options->lease_games : -1;
+        // Only the lease this connection was last sent counts; its holder keeps
+        // it through a timeout, so a late result is still the real one.
+        if (!connection->awaiting_result || lease_index != connection->lease || coordinator->leases[lease_index].first_game != first_game ||
+            coordinator->leases[lease_index].game_count != game_count) {
+            dropTournamentConnection(coordinator, index, "sent a result for games it was never leased");
+            return;
+        }
+        MissileHistogram result;
+        uint64_t result_games = 0;
+        for (int m = 0; m < TOURNAMENT_BINS; ++m) {
+            result.games[m] = getUint64LE(connection->buffer + 16 + 8 * m);
+            result_games += result.games[m];
+        }
+        if (result_games != (uint64_t)game_count) {
+            dropTournamentConnection(coordinator, index, "sent a result with the wrong number of games");
+            return;
+        }
+
+        connection->awaiting_result = false;
+        connection->lease = -1;
+        if (coordinator->leases[lease_index].state == LEASE_DONE) return; // Its reassigned copy finished first
+        completeTournamentLease(coordinator, lease_index, &result);
+        printf("  games %ld-%ld done by worker %d (%ld/%ld leases)\n", first_game, first_game + game_count - 1, index,
+               coordinator->leases_done, coordinator->lease_count);
+        fflush(stdout);
+    #else
+        (void)coordinator;
+        (void)index;
+    #endif
+}
+
+// Closes a worker's connection and puts the lease it was working on back up
+// for grabs, unless another worker has taken it over since.
+void dropTournamentConnection(TournamentCoordinator *coordinator, int index, const char *reason) {
+    #ifndef _WIN32
+        CoordinatorConnection *connection = &coordinator->connections[index];
+        if (connection->lease >= 0) {
+            TournamentLease *lease = &coordinator->leases[connection->lease];
+            if (lease->state == LEASE_ACTIVE && lease->holder == index) lease->state = LEASE_PENDING;
+        }
+        printf("  worker %d %s\n", index, reason);
+        fflush(stdout);
+        close(connection->fd);
+        connection->fd = -1;
+    #else
+        (void)coordinator;
+        (void)index;
+        (void)reason;
+    #endif
+}
+
+// Connects to the coordinator at options->path ("HOST:PORT") and plays the
+// leases it hands out on options->thread_count threads until it says the
+// tournament is finished.
+int runTournamentWorker(const ToolOptions *options) {
+    #ifdef _WIN32
+        (void)options;
+        fprintf(stderr, "Error: Distributed tournaments are not available on this platform.\n");
+        return 1;
+    #else
+        ToolShooter tool_shooter;
+        unsigned char message[TOURNAMENT_RESULT_LEN];
+        long leases_done = 0;
+
+        if (!createToolShooter(options, &tool_shooter)) return 1;
+        int fd = connectToCoordinator(options->path);
+        if (fd < 0) {
+            freeToolShooter(&tool_shooter);
+            return 1;
+        }
+        signal(SIGPIPE, SIG_IGN);
+
+        memset(message, 0, TOURNAMENT_HELLO_LEN);
+        memcpy(message, TOURNAMENT_MAGIC, 4);
+        putUint32LE(message + 4, TOURNAMENT_VERSION);
+        strncpy((char *)message + 8, tool_shooter.shooter.name, TOURNAMENT_SHOOTER_NAME_LEN);
+        bool ok = sendAllBytes(fd, message, TOURNAMENT_HELLO_LEN);
+        while (ok) {
+            if (!receiveAllBytes(fd, message, TOURNAMENT_LEASE_LEN)) {
+                ok = false;
+                break;
+            }
+            uint64_t seed = getUint64LE(message);
+            long first_game = (long)getUint64LE(message + 8);
+            long game_count = (long)getUint64LE(message + 16);
+            if (game_count == 0) break; // Nothing left to hand out
+
+            MissileHistogram histogram;
+            playTournamentRange(&tool_shooter.shooter, seed, first_game, game_count, options->thread_count, &histogram);
+            putUint64LE(message, (uint64_t)first_game);
+            putUint64LE(message + 8, (uint64_t)game_count);
+            for (int m = 0; m < TOURNAMENT_BINS; ++m) putUint64LE(message + 16 + 8 * m, histogram.games[m]);
+            ok = sendAllBytes(fd, message, TOURNAMENT_RESULT_LEN);
+            leases_done++;
+            printf("  games %ld-%ld played\n", first_game, first_game + game_count - 1);
+            fflush(stdout);
+        }
+        close(fd);
+        freeToolShooter(&tool_shooter);
+
+        if (!ok) {
+            fprintf(stderr, "Error: Lost the connection to the coordinator after %ld leases.\n", leases_done);
+            return 1;
+        }
+        printf("Tournament finished; this worker played %ld leases.\n", leases_done);
+        return 0;
+    #endif
+}
+
+// Returns a socket listening on every local address at port, or -1.
+int openTournamentListener(const char *port) {
+    #ifndef _WIN32
+        struct addrinfo hints, *addresses;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        int status = getaddrinfo(NULL, port, &hints, &addresses);
+        if (status != 0) {
+            fprintf(stderr, "Error: Bad port '%s': %s\n", port, gai_strerror(status));
+            return -1;
+        }
+        int fd = -1;
+        for (struct addrinfo *address = addresses; address != NULL && fd < 0; address = address->ai_next) {
+            fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (fd < 0) continue;
+            int reuse = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+            if (bind(fd, address->ai_addr, address->ai_addrlen) != 0 || listen(fd, TOURNAMENT_MAX_WORKERS) != 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(addresses);
+        if (fd < 0) perror("Error listening for workers");
+        return fd;
+    #else
+        (void)port;
+        return -1;
+    #endif
+}
+
+// Returns a socket connected to "HOST:PORT" (or "[IPV6]:PORT"), or -1.
+int connectToCoordinator(const char *address) {
+    #ifndef _WIN32
+        char host[256];
+        const char *colon = strrchr(address, ':');
+        if (colon == NULL || colon == address || (size_t)(colon - address) >= sizeof(host)) {
+            fprintf(stderr, "Error: Expected HOST:PORT, not '%s'.\n", address);
+            return -1;
+        }
+        memcpy(host, address, (size_t)(colon - address));
+        host[colon - address] = '\0';
+        char *host_start = host;
+        if (host[0] == '[' && host[strlen(host) - 1] == ']') {
+            host[strlen(host) - 1] = '\0';
+            host_start++;
+        }
+
+        struct addrinfo hints, *addresses;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        int status = getaddrinfo(host_start, colon + 1, &hints, &addresses);
+        if (status != 0) {
+            fprintf(stderr, "Error: Cannot resolve '%s': %s\n", address, gai_strerror(status));
+            return -1;
+        }
+        int fd = -1;
+        for (struct addrinfo *candidate = addresses; candidate != NULL && fd < 0; candidate = candidate->ai_next) {
+            fd = socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol);
+            if (fd >= 0 && connect(fd, candidate->ai_addr, candidate->ai_addrlen) != 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(addresses);
+        if (fd < 0) perror("Error connecting to the coordinator");
+        return fd;
+    #else
+        (void)address;
+        return -1;
+    #endif
+}
+
+bool sendAllBytes(int fd, const unsigned char *data, size_t len) {
+    #ifndef _WIN32
+        while (len > 0) {
+            ssize_t sent = send(fd, data, len, 0);
+            if (sent < 0 && errno == EINTR) continue;
+            if (sent <= 0) return false;
+            data += sent;
+            len -= (size_t)sent;
+        }
+        return true;
+    #else
+        (void)fd;
+        (void)data;
+        return len == 0;
+    #endif
+}
+
+bool receiveAllBytes(int fd, unsigned char *data, size_t len) {
+    #ifndef _WIN32
+        while (len > 0) {
+            ssize_t got = recv(fd, data, len, 0);
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+            data += got;
+            len -= (size_t)got;
+        }
+        return true;
+    #else
+        (void)fd;
+        (void)data;
+        return len == 0;
+    #endif
+}
+
+//-----------------------------------------------------------------------------
+// XIX. COMMAND-LINE TOOL FUNCTIONS
+//-----------------------------------------------------------------------------
+int runCommandLineTool(int argc, char *argv[]) {
+    ToolOptions options;
+    if (!parseToolOptions(argc, argv, &options)) {
+        printToolUsage(argv[0]);
+        return 2;
+    }
+    if (!selectVectorKernels(options.cpu_level)) return 2;
+
+    if (strcmp(options.mode, "--export") == 0) {
+        return runTrainingDataExport(&options);
+    }
+    if (strcmp(options.mode, "--tune") == 0) {
+        return runParameterTuning(&options);
+    }
+    if (strcmp(options.mode, "--archive") == 0) {
+        return runReplayArchiveCreation(&options);
+    }
+    if (strcmp(options.mode, "--analyze") == 0) {
+        return runArchiveAnalysis(&options);
+    }
+    if (strcmp(options.mode, "--view") == 0) {
+        return runReplayViewer(&options);
+    }
+    if (strcmp(options.mode, "--spectate") == 0) {
+        return runSpectator(&options);
+    }
+    if (strcmp(options.mode, "--bench") == 0) {
+        return runLoadBenchmark(&options);
+    }
+    if (strcmp(options.mode, "--export-session") == 0) {
+        return runSessionExport(&options);
+    }
+    if (strcmp(options.mode, "--import-session") == 0) {
+        return runSessionImport(&options);
+    }
+    if (strcmp(options.mode, "--tournament") == 0) {
+        return runTournament(&options);
+    }
+    if (strcmp(options.mode, "--coordinate") == 0) {
+        return runTournamentCoordinator(&options);
+    }
+    if (strcmp(options.mode, "--work") == 0) {
+        return runTournamentWorker(&options);
+    }
+    printToolUsage(argv[0]);
+    return 2;
+}
 
-    int num_scores = 0;
-    while (num_scores < max_scores_to_read &&
-           fscanf(file, "%3s %d %19[^\n]", 
-                  scores_array[num_scores].player_name,
-                  &scores_array[num_scores].score_value,
-                  scores_array[num_scores].date_time_achieved) == 3) {
-        scores_array[num_scores].player_name[MAX_PLAYER_NAME_LEN - 1] = '\0'; 
-        scores_array[num_scores].date_time_achieved[DATETIME_STR_LEN - 1] = '\0'; 
-        num_scores++;
+bool parseToolOptions(int argc, char *argv[], ToolOptions *options) {
+    options->mode = argv[1];
+    options->path = NULL;
+    options->game_count = 0;
+    options->first_game = 0;
+    options->seed = 1;
+    options->thread_count = defaultWorkerCount();
+    options->shooter_name = "density";
+    options->weights_path = NULL;
+    options->cache_path = NULL;
+    options->cpu_level = NULL;
+    options->session_count = BENCH_DEFAULT_SESSIONS;
+    options->think_ms = 0;
+    options->lease_games = TOURNAMENT_DEFAULT_LEASE;
+    options->lease_timeout_s = TOURNAMENT_DEFAULT_TIMEOUT;
+    options->checkpoint_path = NULL;
+
+    // Tools that only read or simulate take no output FILE argument.
+    bool takes_path = strcmp(options->mode, "--tune") != 0 && strcmp(options->mode, "--spectate") != 0 &&
+                      strcmp(options->mode, "--bench") != 0 && strcmp(options->mode, "--tournament") != 0;
+    bool takes_games = strcmp(options->mode, "--analyze") != 0 && strcmp(options->mode, "--spectate") != 0 &&
+                       strcmp(options->mode, "--export-session") != 0 && strcmp(options->mode, "--import-session") != 0 &&
+                       strcmp(options->mode, "--work") != 0;
+    int positional = takes_path ? 0 : 1;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options->seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--first") == 0 && i + 1 < argc) {
+            options->first_game = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options->thread_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--shooter") == 0 && i + 1 < argc) {
+            options->shooter_name = argv[++i];
+        } else if (strcmp(argv[i], "--weights") == 0 && i + 1 < argc) {
+            options->weights_path = argv[++i];
+        } else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) {
+            options->cpu_level = argv[++i];
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            options->cache_path = argv[++i];
+        } else if (strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) {
+            options->session_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--think") == 0 && i + 1 < argc) {
+            options->think_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--lease") == 0 && i + 1 < argc) {
+            options->lease_games = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--lease-timeout") == 0 && i + 1 < argc) {
+            options->lease_timeout_s = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            options->checkpoint_path = argv[++i];
+        } else if (positional == 0) {
+            options->path = argv[i];
+            positional++;
+        } else if (positional == 1 && takes_games) {
+            // GAMES for the generators; the 1-based game number for --view
+            options->game_count = strtol(argv[i], NULL, 10);
+            positional++;
+        } else {
+            fprintf(stderr, "Error: Unexpected argument '%s'.\n", argv[i]);
+            return false;
+        }
     }
-    fclose(file);
 
-    sortScores(scores_array, num_scores); 
-    return num_scores;
+    if ((takes_path && options->path == NULL) || (takes_games && options->game_count <= 0) || options->first_game < 0) return false;
+    if (options->thread_count < 1) options->thread_count = 1;
+    if (options->thread_count > MAX_WORKER_THREADS) options->thread_count = MAX_WORKER_THREADS;
+    if (options->session_count < 1) options->session_count = 1;
+    if (options->session_count > BENCH_MAX_SESSIONS) options->session_count = BENCH_MAX_SESSIONS;
+    if (options->think_ms < 0) options->think_ms = 0;
+    if (options->lease_games < 1) options->lease_games = 1;
+    if (options->lease_timeout_s < 1) options->lease_timeout_s = 1;
+    return true;
 }
 
-void writeScoresToFile(const ScoreEntry scores_array[], int count) {
-    FILE *file = fopen(SCORE_FILE_NAME, "w"); 
+bool createToolShooter(const ToolOptions *options, ToolShooter *tool_shooter) {
+    static const ShooterParams default_params = {DEFAULT_HIT_WEIGHT, DEFAULT_PARITY_WEIGHT, DEFAULT_TARGET_RADIUS};
+    Shooter *shooter = &tool_shooter->shooter;
+    tool_shooter->model.storage = NULL;
+    tool_shooter->cache = NULL;
+    if (strcmp(options->shooter_name, "density") == 0) {
+        shooter->name = "density";
+        shooter->choose_shot = chooseDensityShot;
+        shooter->context = (void *)&default_params;
+    } else if (strcmp(options->shooter_name, "learned") == 0) {
+        if (options->weights_path == NULL) {
+            fprintf(stderr, "Error: The learned shooter needs --weights FILE.\n");
+            return false;
+        }
+        if (!loadLearnedModel(options->weights_path, &tool_shooter->model)) return false;
+        shooter->name = "learned";
+        shooter->choose_shot = chooseLearnedShot;
+        shooter->context = &tool_shooter->model;
+    } else {
+        fprintf(stderr, "Error: Unknown shooter '%s'.\n", options->shooter_name);
+        return false;
+    }
+
+    if (options->cache_path != NULL) {
+        if (shooter->choose_shot != chooseDensityShot) {
+            fprintf(stderr, "Error: --cache only works with the density shooter.\n");
+            freeLearnedModel(&tool_shooter->model);
+            return false;
+        }
+        tool_shooter->cache = openSolverCache(options->cache_path, &default_params);
+        if (tool_shooter->cache == NULL) return false;
+        tool_shooter->uncached = *shooter;
+        shooter->choose_shot = chooseCachedShot;
+        shooter->context = tool_shooter;
+    }
+    return true;
+}
+
+void freeToolShooter(ToolShooter *tool_shooter) {
+    SolverCache *cache = tool_shooter->cache;
+    if (cache != NULL) {
+        uint64_t lookups = cache->hits + cache->misses;
+        printf("Solver cache: %llu hits, %llu misses (%.1f%% hit rate), %llu entries added",
+               (unsigned long long)cache->hits, (unsigned long long)cache->misses,
+               lookups > 0 ? 100.0 * (double)cache->hits / (double)lookups : 0.0, (unsigned long long)cache->inserts);
+        if (cache->dropped > 0) printf(", %llu dropped (cache full)", (unsigned long long)cache->dropped);
+        if (cache->huge_pages) printf(", %.1f MB on huge pages", (double)hugePageBytes(cache->header) / (1024.0 * 1024.0));
+        printf("\n");
+        closeSolverCache(cache);
+        tool_shooter->cache = NULL;
+    }
+    freeLearnedModel(&tool_shooter->model);
+}
+
+void printToolUsage(const char *program) {
+    fprintf(stderr, "Usage: %s [--broadcast] [--idle-timeout N] [--autosave]  (interactive game)\n", program);
+    fprintf(stderr, "       %s --export FILE GAMES [--seed N] [--first N] [--threads N]\n", program);
+    fprintf(stderr, "         Plays GAMES self-play games and writes one training record per shot.\n");
+    fprintf(stderr, "       %s --tune GAMES [--seed N] [--first N] [--threads N]\n", program);
+    fprintf(stderr, "         Searches density shooter parameters for the lowest mean missiles.\n");
+    fprintf(stderr, "       %s --archive FILE GAMES [--seed N] [--first N]\n", program);
+    fprintf(stderr, "         Plays GAMES self-play games and stores them in a replay archive.\n");
+    fprintf(stderr, "       %s --analyze FILE [--threads N]\n", program);
+    fprintf(stderr, "         Grades every shot of every game in a replay archive.\n");
+    fprintf(stderr, "       %s --view FILE GAME\n", program);
+    fprintf(stderr, "         Steps through game number GAME of a replay archive.\n");
+    fprintf(stderr, "       %s --spectate\n", program);
+    fprintf(stderr, "         Watches games started with --broadcast on this machine.\n");
+    fprintf(stderr, "       %s --bench GAMES [--sessions N] [--think MS] [--seed N]\n", program);
+    fprintf(stderr, "         Plays GAMES through many interleaved sessions and reports latency per operation.\n");
+    fprintf(stderr, "       %s --export-session FILE | --import-session FILE\n", program);
+    fprintf(stderr, "         Moves the saved game to or from a portable file for another machine.\n");
+    fprintf(stderr, "       %s --tournament GAMES [--seed N] [--first N] [--threads N] [--lease N] [--checkpoint FILE]\n", program);
+    fprintf(stderr, "         Plays GAMES self-play games and reports how many missiles the shooter needed.\n");
+    fprintf(stderr, "       %s --coordinate PORT GAMES [--seed N] [--first N] [--lease N] [--lease-timeout SECONDS] [--checkpoint FILE]\n", program);
+    fprintf(stderr, "         Runs a tournament in leases of N games played by --work processes on any machine.\n");
+    fprintf(stderr, "       %s --work HOST:PORT [--threads N]\n", program);
+    fprintf(stderr, "         Plays leases for a coordinator until its tournament is finished.\n");
+    fprintf(stderr, "         --checkpoint records finished leases in FILE so an interrupted run resumes where it stopped.\n");
+    fprintf(stderr, "Shooter options: [--shooter density|learned] [--weights FILE] [--cache FILE]\n");
+    fprintf(stderr, "         --cache shares solved density shooter positions between runs and processes.\n");
+    fprintf(stderr, "CPU option: [--cpu portable|avx2] forces the vector kernels instead of the best supported.\n");
+}
+
+int defaultWorkerCount() {
+    #ifdef _WIN32
+        return 1;
+    #else
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        return cpus > 0 ? (int)cpus : 1;
+    #endif
+}
+
+// Runs worker_function once per element of the workers array, in parallel
+// where threads are available.
+void runWorkers(void *(*worker_function)(void *), void *workers, size_t worker_size, int worker_count) {
+    #ifdef _WIN32
+        for (int i = 0; i < worker_count; ++i) {
+            worker_function((char *)workers + i * worker_size);
+        }
+    #else
+        pthread_t threads[MAX_WORKER_THREADS];
+        bool started[MAX_WORKER_THREADS];
+        for (int i = 0; i < worker_count; ++i) {
+            void *worker = (char *)workers + i * worker_size;
+            started[i] = pthread_create(&threads[i], NULL, worker_function, worker) == 0;
+            if (!started[i]) worker_function(worker); // Run inline if no thread is available
+        }
+        for (int i = 0; i < worker_count; ++i) {
+            if (started[i]) pthread_join(threads[i], NULL);
+        }
+    #endif
+}
+
+void toolMutexInit(ToolMutex *mutex) {
+    #ifdef _WIN32
+        *mutex = 0;
+    #else
+        pthread_mutex_init(mutex, NULL);
+    #endif
+}
+
+void toolMutexLock(ToolMutex *mutex) {
+    #ifdef _WIN32
+        (void)mutex;
+    #else
+        pthread_mutex_lock(mutex);
+    #endif
+}
+
+void toolMutexUnlock(ToolMutex *mutex) {
+    #ifdef _WIN32
+        (void)mutex;
+    #else
+        pthread_mutex_unlock(mutex);
+    #endif
+}
+
+void toolMutexDestroy(ToolMutex *mutex) {
+    #ifdef _WIN32
+        (void)mutex;
+    #else
+        pthread_mutex_destroy(mutex);
+    #endif
+}
+
+// Training data file layout (all integers little-endian):
+//   header  : "VBTD", u32 version, u32 record length
+//   chunks  : up to EXPORT_CHUNK_RECORDS records each, written by one worker
+//   index   : per chunk, u64 file offset and u32 record count
+//   footer  : u64 index offset, u32 chunk count, "VBTI"
+// Each record is the position key, the legal-shot mask (1 bit per cell), the
+// placement density of every cell quantised to u16 out of 65535, the chosen
+// cell index and the ShotProcessResult of firing there.
+int runTrainingDataExport(const ToolOptions *options) {
+    ExportSink sink;
+    ExportWorker workers[MAX_WORKER_THREADS];
+    ToolShooter tool_shooter;
+    int worker_count = options->thread_count;
+    if (worker_count > options->game_count) worker_count = (int)options->game_count;
+
+    if (!createToolShooter(options, &tool_shooter)) return 1;
+    memset(&sink, 0, sizeof(sink));
+    sink.file = fopen(options->path, "wb");
+    if (sink.file == NULL) {
+        perror("Error opening export file for writing");
+        freeToolShooter(&tool_shooter);
+        return 1;
+    }
+    toolMutexInit(&sink.lock);
+
+    unsigned char header[EXPORT_HEADER_LEN];
+    memcpy(header, EXPORT_MAGIC, 4);
+    putUint32LE(header + 4, EXPORT_VERSION);
+    putUint32LE(header + 8, EXPORT_RECORD_LEN);
+    if (fwrite(header, sizeof(header), 1, sink.file) != 1) sink.write_failed = true;
+    sink.next_offset = EXPORT_HEADER_LEN;
+
+    for (int i = 0; i < worker_count; ++i) {
+        workers[i].sink = &sink;
+        workers[i].shooter = &tool_shooter.shooter;
+        workers[i].options = options;
+        workers[i].worker_index = i;
+        workers[i].worker_count = worker_count;
+        workers[i].buffer = malloc((size_t)EXPORT_CHUNK_RECORDS * EXPORT_RECORD_LEN);
+        workers[i].buffered_records = 0;
+        if (workers[i].buffer == NULL) {
+            fprintf(stderr, "Error: Out of memory for export buffers.\n");
+            for (int j = 0; j < i; ++j) free(workers[j].buffer);
+            fclose(sink.file);
+            toolMutexDestroy(&sink.lock);
+            freeToolShooter(&tool_shooter);
+            return 1;
+        }
+    }
+
+    runWorkers(exportWorkerMain, workers, sizeof(ExportWorker), worker_count);
+
+    for (int i = 0; i < worker_count; ++i) free(workers[i].buffer);
+
+    unsigned char footer[EXPORT_FOOTER_LEN];
+    putUint64LE(footer, sink.next_offset);
+    putUint32LE(footer + 8, sink.chunk_count);
+    memcpy(footer + 12, EXPORT_INDEX_MAGIC, 4);
+    if (sink.chunk_count > 0 && fwrite(sink.index, EXPORT_INDEX_ENTRY_LEN, sink.chunk_count, sink.file) != sink.chunk_count) sink.write_failed = true;
+    if (fwrite(footer, sizeof(footer), 1, sink.file) != 1) sink.write_failed = true;
+    if (fclose(sink.file) != 0) sink.write_failed = true;
+    free(sink.index);
+    toolMutexDestroy(&sink.lock);
+    freeToolShooter(&tool_shooter);
+
+    if (sink.write_failed) {
+        fprintf(stderr, "Error: Failed to write complete training data to %s.\n", options->path);
+        return 1;
+    }
+    printf("Exported %llu records from %ld games in %u chunks to %s.\n",
+           (unsigned long long)sink.record_count, options->game_count, sink.chunk_count, options->path);
+    return 0;
+}
+
+void *exportWorkerMain(void *arg) {
+    ExportWorker *worker = arg;
+    const ToolOptions *options = worker->options;
+    GameState game;
+    Rng rng;
+    unsigned int density[GRID_SIZE][GRID_SIZE];
+
+    for (long n = worker->worker_index; n < options->game_count; n += worker->worker_count) {
+        rngSeed(&rng, selfPlayGameSeed(options->seed, options->first_game + n));
+        resetGameState(&game, &rng);
+
+        while (game.ships_remaining_count > 0 && game.missiles_fired_count < GRID_SIZE * GRID_SIZE) {
+            Coordinate shot = worker->shooter->choose_shot(worker->shooter->context, game.player_target_grid);
+            if (shot.row < 0 || game.player_target_grid[shot.row][shot.col] != EMPTY_CELL) break;
+
+            computeTargetDensity(game.player_target_grid, DEFAULT_HIT_WEIGHT, density);
+            GameState before = game;
+            int sunk_ship_index;
+            ShotProcessResult result = fireShot(&game, shot.row, shot.col, &sunk_ship_index);
+            appendExportRecord(worker, &before, density, shot, result);
+        }
+    }
+    flushExportChunk(worker);
+    return NULL;
+}
+
+void appendExportRecord(ExportWorker *worker, const GameState *game, const unsigned int density[GRID_SIZE][GRID_SIZE], Coordinate shot, ShotProcessResult result) {
+    unsigned char *record = worker->buffer + (size_t)worker->buffered_records * EXPORT_RECORD_LEN;
+    PositionKey key;
+    uint64_t total_density = 0;
+
+    encodePosition(game->player_target_grid, &key);
+    memcpy(record, key.bytes, POSITION_KEY_LEN);
+    record += POSITION_KEY_LEN;
+    buildLegalShotMask(game->player_target_grid, record);
+    record += LEGAL_MASK_BYTES;
+
+    for (int r = 0; r < GRID_SIZE; ++r) {
+        for (int c = 0; c < GRID_SIZE; ++c) total_density += density[r][c];
+    }
+    for (int r = 0; r < GRID_SIZE; ++r) {
+        for (int c = 0; c < GRID_SIZE; ++c) {
+            uint16_t quantised = total_density > 0 ? (uint16_t)((density[r][c] * 65535ULL) / total_density) : 0;
+            putUint16LE(record, quantised);
+            record += 2;
+        }
+    }
+    record[0] = (unsigned char)(shot.row * GRID_SIZE + shot.col);
+    record[1] = (unsigned char)result;
+
+    if (++worker->buffered_records == EXPORT_CHUNK_RECORDS) flushExportChunk(worker);
+}
+
+// Writes the worker's buffered records as one chunk and indexes it.
+void flushExportChunk(ExportWorker *worker) {
+    ExportSink *sink = worker->sink;
+    if (worker->buffered_records == 0) return;
+
+    toolMutexLock(&sink->lock);
+    if (sink->chunk_count == sink->chunk_capacity) {
+        uint32_t new_capacity = sink->chunk_capacity == 0 ? 64 : sink->chunk_capacity * 2;
+        unsigned char *new_index = realloc(sink->index, (size_t)new_capacity * EXPORT_INDEX_ENTRY_LEN);
+        if (new_index == NULL) {
+            sink->write_failed = true;
+            toolMutexUnlock(&sink->lock);
+            worker->buffered_records = 0;
+            return;
+        }
+        sink->index = new_index;
+        sink->chunk_capacity = new_capacity;
+    }
+
+    size_t chunk_len = (size_t)worker->buffered_records * EXPORT_RECORD_LEN;
+    if (fwrite(worker->buffer, 1, chunk_len, sink->file) != chunk_len) {
+        sink->write_failed = true;
+    } else {
+        unsigned char *entry = sink->index + (size_t)sink->chunk_count * EXPORT_INDEX_ENTRY_LEN;
+        putUint64LE(entry, sink->next_offset);
+        putUint32LE(entry + 8, worker->buffered_records);
+        sink->chunk_count++;
+        sink->next_offset += chunk_len;
+        sink->record_count += worker->buffered_records;
+    }
+    toolMutexUnlock(&sink->lock);
+    worker->buffered_records = 0;
+}
+
+// Successive rounds of TUNE_BATCH_GAMES games. Every candidate plays the
+// same layouts (common random numbers), so candidates are compared on
+// per-game missile differences, whose variance is far lower than that of
+// the raw counts. After each round, candidates whose mean difference to the
+// current best exceeds TUNE_DROP_SIGMAS standard errors stop playing.
+int runParameterTuning(const ToolOptions *options) {
+    static const int hit_weights[] = {5, 10, 20, 40, 80};
+    static const int parity_weights[] = {25, 50, 75, 100};
+    static const int target_radii[] = {0, 1, 2};
+    const int candidate_count = 5 * 4 * 3;
+    TuneCandidate candidates[5 * 4 * 3];
+    TuneWorker workers[MAX_WORKER_THREADS];
+    int worker_count = options->thread_count;
+    int best = 0;
+
+    int n = 0;
+    for (int h = 0; h < 5; ++h) {
+        for (int p = 0; p < 4; ++p) {
+            for (int t = 0; t < 3; ++t) {
+                candidates[n].params.hit_weight = hit_weights[h];
+                candidates[n].params.parity_weight = parity_weights[p];
+                candidates[n].params.target_radius = target_radii[t];
+                candidates[n].alive = true;
+                candidates[n].games_played = 0;
+                candidates[n].missiles = malloc(sizeof(short) * (size_t)options->game_count);
+                if (candidates[n].missiles == NULL) {
+                    fprintf(stderr, "Error: Out of memory for tuning results.\n");
+                    for (int j = 0; j < n; ++j) free(candidates[j].missiles);
+                    return 1;
+                }
+                n++;
+            }
+        }
+    }
+
+    printf("Tuning %d density shooter candidates over up to %ld games...\n", candidate_count, options->game_count);
+    int alive_count = candidate_count;
+    for (long round_start = 0; round_start < options->game_count && alive_count > 1; round_start += TUNE_BATCH_GAMES) {
+        long round_games = options->game_count - round_start;
+        if (round_games > TUNE_BATCH_GAMES) round_games = TUNE_BATCH_GAMES;
+
+        for (int i = 0; i < worker_count; ++i) {
+            workers[i].candidates = candidates;
+            workers[i].candidate_count = candidate_count;
+            workers[i].options = options;
+            workers[i].round_start = round_start;
+            workers[i].round_games = round_games;
+            workers[i].worker_index = i;
+            workers[i].worker_count = worker_count;
+        }
+        runWorkers(tuneWorkerMain, workers, sizeof(TuneWorker), worker_count);
+
+        long played = round_start + round_games;
+        double best_mean = 0.0;
+        best = -1;
+        for (int c = 0; c < candidate_count; ++c) {
+            if (!candidates[c].alive) continue;
+            candidates[c].games_played = played;
+            long total = 0;
+            for (long g = 0; g < played; ++g) total += candidates[c].missiles[g];
+            double mean = (double)total / played;
+            if (best == -1 || mean < best_mean) {
+                best = c;
+                best_mean = mean;
+            }
+        }
+
+        for (int c = 0; c < candidate_count; ++c) {
+            if (!candidates[c].alive || c == best) continue;
+            double sum = 0.0, sum_squares = 0.0;
+            for (long g = 0; g < played; ++g) {
+                double diff = candidates[c].missiles[g] - candidates[best].missiles[g];
+                sum += diff;
+                sum_squares += diff * diff;
+            }
+            double mean_diff = sum / played;
+            double variance = played > 1 ? (sum_squares - sum * mean_diff) / (played - 1) : 0.0;
+            double standard_error = variance > 0.0 ? sqrt(variance / played) : 0.0;
+            if (mean_diff > TUNE_DROP_SIGMAS * standard_error) {
+                candidates[c].alive = false;
+                alive_count--;
+            }
+        }
+        printf("  after %6ld games: %2d candidates left, best %.3f missiles\n", played, alive_count, best_mean);
+    }
+
+    printf("\nhit_weight | parity_weight | target_radius | games | mean missiles\n");
+    printf("-----------|---------------|---------------|-------|--------------\n");
+    for (int c = 0; c < candidate_count; ++c) {
+        if (!candidates[c].alive) continue;
+        long total = 0;
+        for (long g = 0; g < candidates[c].games_played; ++g) total += candidates[c].missiles[g];
+        printf("%-10d | %-13d | %-13d | %-5ld | %.3f%s\n", candidates[c].params.hit_weight,
+               candidates[c].params.parity_weight, candidates[c].params.target_radius,
+               candidates[c].games_played, (double)total / candidates[c].games_played, c == best ? "  <- best" : "");
+    }
+
+    for (int c = 0; c < candidate_count; ++c) free(candidates[c].missiles);
+    return 0;
+}
+
+void *tuneWorkerMain(void *arg) {
+    TuneWorker *worker = arg;
+    GameState game;
+    Rng rng;
+
+    for (long g = worker->round_start + worker->worker_index; g < worker->round_start + worker->round_games; g += worker->worker_count) {
+        uint64_t game_seed = selfPlayGameSeed(worker->options->seed, worker->options->first_game + g);
+        for (int c = 0; c < worker->candidate_count; ++c) {
+            TuneCandidate *candidate = &worker->candidates[c];
+            if (!candidate->alive) continue;
+
+            Shooter shooter = {"density", chooseDensityShot, &candidate->params};
+            rngSeed(&rng, game_seed);
+            resetGameState(&game, &rng);
+            candidate->missiles[g] = (short)playSelfPlayGame(&game, &shooter);
+        }
+    }
+    return NULL;
+}
+
+int runReplayArchiveCreation(const ToolOptions *options) {
+    ReplayArchiveWriter writer;
+    ToolShooter tool_shooter;
+    GameState game;
+    Rng rng;
+
+    if (!createToolShooter(options, &tool_shooter)) return 1;
+    if (!openReplayArchiveWriter(options->path, &writer)) {
+        freeToolShooter(&tool_shooter);
+        return 1;
+    }
+    for (long n = 0; n < options->game_count; ++n) {
+        rngSeed(&rng, selfPlayGameSeed(options->seed, options->first_game + n));
+        resetGameState(&game, &rng);
+        playSelfPlayGame(&game, &tool_shooter.shooter);
+        if (!appendReplay(&writer, &game)) break;
+    }
+    bool ok = closeReplayArchiveWriter(&writer);
+    uint64_t games_written = writer.game_count;
+    uint64_t bytes_written = writer.next_offset; // Up to the index, now that the last block is flushed
+    freeToolShooter(&tool_shooter);
+
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to write complete replay archive to %s.\n", options->path);
+        return 1;
+    }
+    printf("Archived %llu games (%.1f bytes per game) to %s.\n", (unsigned long long)games_written,
+           games_written > 0 ? (double)(bytes_written - REPLAY_HEADER_LEN) / games_written : 0.0, options->path);
+    return 0;
+}
+
+// Batch version of the post-game analysis: workers stream disjoint blocks
+// of the archive and the per-worker totals are merged at the end.
+int runArchiveAnalysis(const ToolOptions *options) {
+    ReplayArchive archive;
+    AnalyzeWorker workers[MAX_WORKER_THREADS];
+    AnalyzeWorker total;
+    int worker_count = options->thread_count;
+
+    if (!openReplayArchive(options->path, &archive)) return 1;
+    if ((uint64_t)worker_count > archive.block_count) worker_count = archive.block_count > 0 ? (int)archive.block_count : 1;
+
+    memset(workers, 0, sizeof(workers));
+    for (int i = 0; i < worker_count; ++i) {
+        workers[i].archive = &archive;
+        workers[i].path = options->path;
+        workers[i].worker_index = i;
+        workers[i].worker_count = worker_count;
+    }
+    runWorkers(analyzeWorkerMain, workers, sizeof(AnalyzeWorker), worker_count);
+
+    memset(&total, 0, sizeof(total));
+    for (int i = 0; i < worker_count; ++i) {
+        total.games += workers[i].games;
+        total.shots += workers[i].shots;
+        total.missiles += workers[i].missiles;
+        total.missed_opportunities += workers[i].missed_opportunities;
+        total.quality_total += workers[i].quality_total;
+        total.read_failed |= workers[i].read_failed;
+        for (int b = 0; b <= 10; ++b) total.efficiency_histogram[b] += workers[i].efficiency_histogram[b];
+    }
+    closeReplayArchive(&archive);
+
+    if (total.read_failed) {
+        fprintf(stderr, "Error: Some games in %s could not be read.\n", options->path);
+    }
+    if (total.games == 0) {
+        printf("No games analyzed.\n");
+        return total.read_failed ? 1 : 0;
+    }
+    printf("Games analyzed:        %llu\n", (unsigned long long)total.games);
+    printf("Mean missiles:         %.3f\n", (double)total.missiles / total.games);
+    printf("Shot efficiency:       %.1f%%\n", 100.0 * total.quality_total / total.shots);
+    printf("Missed opportunities:  %.2f per game (worst %d per game counted)\n",
+           (double)total.missed_opportunities / total.games, MAX_MISSED_OPPORTUNITIES);
+    printf("Per-game efficiency:\n");
+    for (int b = 0; b <= 10; ++b) {
+        if (total.efficiency_histogram[b] == 0) continue;
+        if (b < 10) printf("  %3d-%2d%% : %llu\n", b * 10, b * 10 + 9, (unsigned long long)total.efficiency_histogram[b]);
+        else printf("     100%% : %llu\n", (unsigned long long)total.efficiency_histogram[b]);
+    }
+    return total.read_failed ? 1 : 0;
+}
+
+void *analyzeWorkerMain(void *arg) {
+    AnalyzeWorker *worker = arg;
+    const ReplayArchive *archive = worker->archive;
+    unsigned char *block = NULL;
+    size_t block_capacity = 0;
+    GameState game;
+    RegretReport report;
+
+    FILE *file = fopen(worker->path, "rb");
     if (file == NULL) {
-        perror("Error: Could not write scores to file");
-        return;
+        worker->read_failed = true;
+        return NULL;
     }
 
-    for (int i = 0; i < count; ++i) {
-        fprintf(file, "%s %d %s\n", scores_array[i].player_name, scores_array[i].score_value, scores_array[i].date_time_achieved);
+    for (uint64_t b = (uint64_t)worker->worker_index; b < archive->block_count; b += (uint64_t)worker->worker_count) {
+        size_t block_len = (size_t)(archive->block_offsets[b + 1] - archive->block_offsets[b]);
+        if (block_len > block_capacity) {
+            unsigned char *new_block = realloc(block, block_len);
+            if (new_block == NULL) { worker->read_failed = true; break; }
+            block = new_block;
+            block_capacity = block_len;
+        }
+        if (fseek(file, (long)archive->block_offsets[b], SEEK_SET) != 0 || fread(block, 1, block_len, file) != block_len) {
+            worker->read_failed = true;
+            continue;
+        }
+
+        uint64_t first = b * archive->games_per_block;
+        uint64_t last = first + archive->games_per_block;
+        if (last > archive->game_count) last = archive->game_count;
+        for (uint64_t g = first; g < last; ++g) {
+            size_t start = archive->game_offsets[g];
+            size_t end = g + 1 < last ? archive->game_offsets[g + 1] : block_len;
+            if (end < start || end > block_len || !decodeReplay(block + start, end - start, &game)) {
+                worker->read_failed = true;
+                continue;
+            }
+            analyzeShotHistory(&game, &report);
+            worker->games++;
+            worker->shots += (uint64_t)report.shots_analyzed;
+            worker->missiles += (uint64_t)game.missiles_fired_count;
+            worker->missed_opportunities += (uint64_t)report.missed_count;
+            worker->quality_total += report.efficiency * report.shots_analyzed;
+            worker->efficiency_histogram[(int)(report.efficiency * 10.0)]++;
+        }
     }
+    free(block);
     fclose(file);
+    return NULL;
 }
 
-void sortScores(ScoreEntry scores_array[], int count) {
-    ScoreEntry temp;
-    for (int i = 0; i < count - 1; ++i) {
-        for (int j = 0; j < count - i - 1; ++j) {
-            if (scores_array[j].score_value > scores_array[j + 1].score_value) {
-                temp = scores_array[j];
-                scores_array[j] = scores_array[j + 1];
-                scores_array[j + 1] = temp;
+int runReplayViewer(const ToolOptions *options) {
+    ReplayArchive archive;
+    GameState game;
+    GameState position;
+    char input[16];
+
+    if (!openReplayArchive(options->path, &archive)) return 1;
+    bool loaded = readReplay(&archive, (uint64_t)(options->game_count - 1), &game);
+    uint64_t archived_games = archive.game_count;
+    closeReplayArchive(&archive);
+    if (!loaded) {
+        fprintf(stderr, "Error: Game %ld is not in %s (it holds %llu games).\n", options->game_count, options->path,
+                (unsigned long long)archived_games);
+        return 1;
+    }
+
+    ReplaySeeker *seeker = malloc(sizeof(ReplaySeeker));
+    if (seeker == NULL) {
+        fprintf(stderr, "Error: Out of memory for replay snapshots.\n");
+        return 1;
+    }
+    buildReplaySeeker(&game, seeker);
+
+    int move = 0;
+    while (true) {
+        seekReplay(seeker, move, &position);
+        clearScreen();
+        printf("REPLAY: game %ld, move %d of %d\n", options->game_count, move, seeker->move_count);
+        displayPlayerTargetGrid(position.player_target_grid, position.last_shot_coord, position.last_shot_valid);
+        displayShipStatusAndStats(&position);
+        printf("Enter = next move, p = previous, a move number to jump, q = quit: ");
+        if (!safeGets(input, sizeof(input)) || toupper(input[0]) == 'Q') break;
+        if (input[0] == '\0' || toupper(input[0]) == 'N') move = move < seeker->move_count ? move + 1 : move;
+        else if (toupper(input[0]) == 'P') move = move > 0 ? move - 1 : 0;
+        else if (isdigit((unsigned char)input[0])) move = atoi(input) < seeker->move_count ? atoi(input) : seeker->move_count;
+    }
+    free(seeker);
+    return 0;
+}
+
+// Writes the saved game of this directory as a portable session file.
+int runSessionExport(const ToolOptions *options) {
+    GameState game;
+    if (!loadGameState(&game)) {
+        fprintf(stderr, "Error: No saved game to export.\n");
+        return 1;
+    }
+    unsigned char out[SESSION_HEADER_LEN + SESSION_MAX_RECORD_LEN];
+    memcpy(out, SESSION_MAGIC, 4);
+    putUint32LE(out + 4, SESSION_VERSION);
+    size_t len = SESSION_HEADER_LEN + encodeSession(&game, out + SESSION_HEADER_LEN);
+    if (!writeFileAtomically(options->path, out, len)) return 1;
+    printf("Exported the saved game (%d missiles fired) to %s (%zu bytes).\n", game.missiles_fired_count, options->path, len);
+    return 0;
+}
+
+// Rebuilds a portable session file into this directory's save file.
+int runSessionImport(const ToolOptions *options) {
+    FILE *existing = fopen(SAVE_FILE_NAME, "rb");
+    if (existing != NULL) {
+        fclose(existing);
+        fprintf(stderr, "Error: %s already holds a saved game; move it aside before importing.\n", SAVE_FILE_NAME);
+        return 1;
+    }
+    FILE *file = fopen(options->path, "rb");
+    if (file == NULL) {
+        perror("Error opening session file");
+        return 1;
+    }
+    unsigned char in[SESSION_HEADER_LEN + SESSION_MAX_RECORD_LEN + 1];
+    size_t len = fread(in, 1, sizeof(in), file);
+    fclose(file);
+
+    GameState game;
+    if (len < SESSION_HEADER_LEN || len == sizeof(in) || memcmp(in, SESSION_MAGIC, 4) != 0 ||
+        getUint32LE(in + 4) != SESSION_VERSION ||
+        !decodeSession(in + SESSION_HEADER_LEN, len - SESSION_HEADER_LEN, &game)) {
+        fprintf(stderr, "Error: %s is not a valid session file.\n", options->path);
+        return 1;
+    }
+    if (!game.game_in_progress) {
+        fprintf(stderr, "Error: The game in %s is already finished.\n", options->path);
+        return 1;
+    }
+    if (!saveGameState(&game)) return 1;
+    printf("Imported the game (%d missiles fired). Choose Resume Game to continue it.\n", game.missiles_fired_count);
+    return 0;
+}
+
+// Load generator. Runs --sessions simulated players on one thread against
+// the real game, save and score code, in a scratch directory so the
+// player's own files are untouched. Each player fires, autosaves after
+// the shot and records its score when it wins. With --think MS, players
+// wait an exponentially distributed think time between commands and
+// latency is measured from when the command was due, not when it ran, so
+// a stall is charged to every command it delayed.
+int runLoadBenchmark(const ToolOptions *options) {
+    #ifdef _WIN32
+        (void)options;
+        fprintf(stderr, "Error: The load generator is not available on this platform.\n");
+        return 1;
+    #else
+        static const char *operation_names[BENCH_OPERATION_COUNT] = {"new game", "fire", "save", "scores"};
+        ToolShooter tool_shooter;
+        if (!createToolShooter(options, &tool_shooter)) return 1;
+
+        int session_count = options->session_count;
+        BenchSession *sessions = calloc((size_t)session_count, sizeof(BenchSession));
+        LatencyHistogram *histograms = calloc(BENCH_OPERATION_COUNT, sizeof(LatencyHistogram));
+        char directory[] = "/tmp/valencia_bench_XXXXXX";
+        if (sessions == NULL || histograms == NULL) {
+            fprintf(stderr, "Error: Out of memory for benchmark sessions.\n");
+            free(sessions);
+            free(histograms);
+            freeToolShooter(&tool_shooter);
+            return 1;
+        }
+        if (mkdtemp(directory) == NULL || chdir(directory) != 0) {
+            perror("Error creating benchmark directory");
+            free(sessions);
+            free(histograms);
+            freeToolShooter(&tool_shooter);
+            return 1;
+        }
+
+        Rng think_rng;
+        rngSeed(&think_rng, options->seed);
+        uint64_t think_mean_ns = (uint64_t)options->think_ms * 1000000u;
+        uint64_t begin = monotonicNanos();
+        for (int i = 0; i < session_count; ++i) {
+            snprintf(sessions[i].save_path, sizeof(sessions[i].save_path), "session_%d.dat", i);
+            sessions[i].shadow.path = sessions[i].save_path;
+            sessions[i].shadow.fd = -1;
+            sessions[i].due_ns = begin;
+        }
+
+        long started = 0, finished = 0;
+        uint64_t shots = 0;
+        bool failed = false;
+        printf("Benchmarking %ld games over %d sessions (think time %d ms, %s shooter)...\n",
+               options->game_count, session_count, options->think_ms, tool_shooter.shooter.name);
+        fflush(stdout);
+        while (finished < options->game_count && !failed) {
+            // Serve whichever player's command is due first.
+            BenchSession *session = NULL;
+            for (int i = 0; i < session_count; ++i) {
+                if (!sessions[i].playing && started >= options->game_count) continue;
+                if (session == NULL || sessions[i].due_ns < session->due_ns) session = &sessions[i];
+            }
+            if (session == NULL) break;
+
+            Coordinate shot = {0, 0};
+            if (session->playing) {
+                shot = tool_shooter.shooter.choose_shot(tool_shooter.shooter.context, session->game.player_target_grid); // Client side, untimed
+            }
+            uint64_t now = monotonicNanos();
+            if (think_mean_ns > 0 && session->due_ns > now) {
+                uint64_t wait = session->due_ns - now;
+                struct timespec pause = {(time_t)(wait / 1000000000u), (long)(wait % 1000000000u)};
+                nanosleep(&pause, NULL);
+            }
+            uint64_t start = monotonicNanos();
+            uint64_t intended = think_mean_ns > 0 ? session->due_ns : start;
+
+            if (!session->playing) {
+                Rng rng;
+                rngSeed(&rng, selfPlayGameSeed(options->seed, options->first_game + started));
+                resetGameState(&session->game, &rng);
+                recordLatency(&histograms[BENCH_NEW_GAME], monotonicNanos() - intended);
+                session->playing = true;
+                started++;
+            } else if (shot.row < 0 || session->game.player_target_grid[shot.row][shot.col] != EMPTY_CELL ||
+                       session->game.missiles_fired_count >= GRID_SIZE * GRID_SIZE) {
+                fprintf(stderr, "Error: The %s shooter stopped before the game ended.\n", tool_shooter.shooter.name);
+                failed = true;
+            } else {
+                int sunk_ship_index;
+                fireShot(&session->game, shot.row, shot.col, &sunk_ship_index);
+                session->game.last_shot_coord = shot;
+                session->game.last_shot_valid = true;
+                uint64_t fired = monotonicNanos();
+                recordLatency(&histograms[BENCH_FIRE], fired - intended);
+                shots++;
+
+                failed = !saveGameStateIncremental(&session->game, &session->shadow);
+                uint64_t saved = monotonicNanos();
+                recordLatency(&histograms[BENCH_SAVE], saved - fired);
+
+                if (session->game.ships_remaining_count == 0) {
+                    ScoreEntry scores[11];
+                    int count = readScoresFromFile(scores, 10);
+                    if (scoreQualifies(scores, count, session->game.missiles_fired_count)) {
+                        ScoreEntry entry;
+                        snprintf(entry.player_name, sizeof(entry.player_name), "B%02d", (int)(started % 100));
+                        entry.score_value = session->game.missiles_fired_count;
+                        getCurrentDateTimeString(entry.date_time_achieved, DATETIME_STR_LEN);
+                        count = insertScore(scores, count, &entry);
+                        writeScoresToFile(scores, count);
+                    }
+                    recordLatency(&histograms[BENCH_SCORES], monotonicNanos() - saved);
+                    endIncrementalSaves(&session->shadow);
+                    remove(session->save_path);
+                    session->playing = false;
+                    finished++;
+                }
             }
+
+            uint64_t think = 0;
+            if (think_mean_ns > 0) {
+                double uniform = (double)(rngNext(&think_rng) >> 11) / 9007199254740992.0;
+                think = (uint64_t)(-log(1.0 - uniform) * (double)think_mean_ns);
+            }
+            session->due_ns = (think_mean_ns > 0 ? session->due_ns : monotonicNanos()) + think;
+        }
+        double elapsed = (double)(monotonicNanos() - begin) / 1e9;
+
+        for (int i = 0; i < session_count; ++i) {
+            endIncrementalSaves(&sessions[i].shadow);
+            remove(sessions[i].save_path);
         }
+        remove(SCORE_FILE_NAME);
+        if (chdir("/") == 0) rmdir(directory);
+
+        printf("\n%ld games, %llu shots in %.2f s (%.0f shots/s)\n", finished, (unsigned long long)shots,
+               elapsed, elapsed > 0.0 ? (double)shots / elapsed : 0.0);
+        printf("Operation | Count    | Ops/s     | p50 us    | p90 us    | p99 us    | p99.9 us  | max us\n");
+        printf("----------|----------|-----------|-----------|-----------|-----------|-----------|----------\n");
+        for (int op = 0; op < BENCH_OPERATION_COUNT; ++op) {
+            const LatencyHistogram *histogram = &histograms[op];
+            printf("%-9s | %-8llu | %-9.0f | %-9.1f | %-9.1f | %-9.1f | %-9.1f | %.1f\n", operation_names[op],
+                   (unsigned long long)histogram->total, elapsed > 0.0 ? (double)histogram->total / elapsed : 0.0,
+                   latencyPercentile(histogram, 0.50) / 1e3, latencyPercentile(histogram, 0.90) / 1e3,
+                   latencyPercentile(histogram, 0.99) / 1e3, latencyPercentile(histogram, 0.999) / 1e3,
+                   histogram->max_ns / 1e3);
+        }
+
+        free(sessions);
+        free(histograms);
+        freeToolShooter(&tool_shooter);
+        return failed ? 1 : 0;
+    #endif
+}
+
+void recordLatency(LatencyHistogram *histogram, uint64_t nanoseconds) {
+    int bucket = (int)nanoseconds;
+    if (nanoseconds >= LATENCY_SUB_BUCKETS) {
+        int exponent = 63 - __builtin_clzll(nanoseconds); // At least 4
+        int sub_bucket = (int)(nanoseconds >> (exponent - 4)) - LATENCY_SUB_BUCKETS;
+        bucket = LATENCY_SUB_BUCKETS + (exponent - 4) * LATENCY_SUB_BUCKETS + sub_bucket;
     }
+    histogram->counts[bucket]++;
+    histogram->total++;
+    if (nanoseconds > histogram->max_ns) histogram->max_ns = nanoseconds;
 }
 
-void getCurrentDateTimeString(char* buffer, int buffer_size) {
-    time_t now = time(NULL);
-    struct tm *tm_info = localtime(&now);
-    strftime(buffer, buffer_size, "%Y-%m-%d %H:%M", tm_info);
+// Upper edge of the bucket holding the given fraction of samples.
+uint64_t latencyPercentile(const LatencyHistogram *histogram, double fraction) {
+    if (histogram->total == 0) return 0;
+    uint64_t rank = (uint64_t)ceil(fraction * (double)histogram->total);
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; ++bucket) {
+        seen += histogram->counts[bucket];
+        if (seen < rank || histogram->counts[bucket] == 0) continue;
+        if (bucket < LATENCY_SUB_BUCKETS) return (uint64_t)bucket;
+        int exponent = (bucket - LATENCY_SUB_BUCKETS) / LATENCY_SUB_BUCKETS + 4;
+        uint64_t sub_bucket = (uint64_t)((bucket - LATENCY_SUB_BUCKETS) % LATENCY_SUB_BUCKETS);
+        uint64_t upper = ((LATENCY_SUB_BUCKETS + sub_bucket + 1) << (exponent - 4)) - 1;
+        return upper < histogram->max_ns ? upper : histogram->max_ns;
+    }
+    return histogram->max_ns;
+}
+
+void putUint16LE(unsigned char *out, uint16_t value) {
+    out[0] = (unsigned char)(value & 0xFF);
+    out[1] = (unsigned char)(value >> 8);
+}
+
+void putUint32LE(unsigned char *out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+void putUint64LE(unsigned char *out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+uint32_t getUint32LE(const unsigned char *in) {
+    return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+uint64_t getUint64LE(const unsigned char *in) {
+    return (uint64_t)getUint32LE(in) | (uint64_t)getUint32LE(in + 4) << 32;
 }
 
+float getFloat32LE(const unsigned char *in) {
+    uint32_t bits = getUint32LE(in);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
 
 //-----------------------------------------------------------------------------
-// XI. UTILITY FUNCTIONS
+// XX. UTILITY FUNCTIONS
 //-----------------------------------------------------------------------------
+uint64_t monotonicNanos() {
+    struct timespec now;
+    #ifdef _WIN32
+        timespec_get(&now, TIME_UTC);
+    #else
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    #endif
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
 void clearScreen() {
     #ifdef _WIN32
         system("cls");
     #else
-        system("clear");
+        // ANSI home, erase display and erase scrollback, as "clear" does,
+        // without spawning a process every turn
+        fputs("\033[H\033[2J\033[3J", stdout);
     #endif
 }
 
@@ -835,7 +4854,8 @@ void pauseForKey(const char* message) {
 }
 
 
-void safeGets(char *buffer, int size) {
+// Returns false at end of input, leaving buffer empty.
+bool safeGets(char *buffer, int size) {
     if (fgets(buffer, size, stdin) != NULL) {
         size_t len = strlen(buffer);
         if (len > 0 && buffer[len - 1] == '\n') {
@@ -846,8 +4866,9 @@ void safeGets(char *buffer, int size) {
                 while ((c = getchar()) != '\n' && c != EOF); // Clear rest of stdin
             }
         }
-    } else {
-        buffer[0] = '\0'; 
-        clearerr(stdin); 
+        return true;
     }
+    buffer[0] = '\0'; 
+    clearerr(stdin); 
+    return false;
 }
\ No newline at end of file